@@ -0,0 +1,113 @@
+#include "adaptive-quality.h"
+
+/* seconds between evaluations */
+#define QUALITY_INTERVAL 1.0f
+/* healthy intervals needed before quality steps back up */
+#define QUALITY_RECOVER_INTERVALS 5
+/* share of the frame budget the transition passes may use */
+#define QUALITY_PASS_BUDGET 0.5f
+/* timed frames at the current level needed to judge the pass time */
+#define QUALITY_PASS_FRAMES 30
+
+static const char *quality_level_names[] = {
+	"full",
+	"half resolution matte",
+	"half resolution browser",
+	"reduced browser fps",
+	"direct cut",
+};
+
+static void read_counters(uint32_t *lagged, uint32_t *skipped)
+{
+	video_t *video = obs_get_video();
+	*lagged = obs_get_lagged_frames();
+	*skipped = video ? video_output_get_skipped_frames(video) : 0;
+}
+
+void adaptive_quality_reset(struct adaptive_quality *aq)
+{
+	os_atomic_set_long(&aq->level, QUALITY_FULL);
+	os_atomic_set_bool(&aq->reset, true);
+}
+
+static void clear_window(struct adaptive_quality *aq)
+{
+	aq->elapsed = 0.0f;
+	aq->pass_ms = 0.0f;
+	aq->pass_frames = 0;
+}
+
+bool adaptive_quality_tick(struct adaptive_quality *aq, float seconds,
+			   bool transitioning, enum quality_level rendered,
+			   float pass_ms, uint32_t pass_frames, const char *name)
+{
+	if (os_atomic_exchange_bool(&aq->reset, false)) {
+		clear_window(aq);
+		aq->healthy = 0;
+		read_counters(&aq->last_lagged, &aq->last_skipped);
+	}
+
+	/* a new level mostly applies from the next start, frames rendered
+	 * before that say nothing about it */
+	const enum quality_level previous = adaptive_quality_get_level(aq);
+	if (!transitioning || rendered != previous) {
+		if (rendered != previous)
+			clear_window(aq);
+		read_counters(&aq->last_lagged, &aq->last_skipped);
+		return false;
+	}
+
+	aq->pass_ms += pass_ms;
+	aq->pass_frames += pass_frames;
+	aq->elapsed += seconds;
+	if (aq->elapsed < QUALITY_INTERVAL)
+		return false;
+	aq->elapsed = 0.0f;
+
+	uint32_t lagged, skipped;
+	read_counters(&lagged, &skipped);
+	const uint32_t new_lagged = lagged - aq->last_lagged;
+	const uint32_t new_skipped = skipped - aq->last_skipped;
+	aq->last_lagged = lagged;
+	aq->last_skipped = skipped;
+
+	float budget_ms = 0.0f;
+	struct obs_video_info ovi;
+	if (obs_get_video_info(&ovi) && ovi.fps_num)
+		budget_ms = 1000.0f * (float)ovi.fps_den / (float)ovi.fps_num;
+
+	/* a direct cut renders no passes, only the lag counts there */
+	const bool timed = previous < QUALITY_DIRECT_CUT && budget_ms > 0.0f;
+	const bool judged = !timed || aq->pass_frames >= QUALITY_PASS_FRAMES;
+	const float avg_ms =
+		aq->pass_frames ? aq->pass_ms / (float)aq->pass_frames : 0.0f;
+	const bool slow = timed && judged &&
+			  avg_ms > budget_ms * QUALITY_PASS_BUDGET;
+	const bool pressure = new_lagged || new_skipped || slow;
+	if (judged) {
+		aq->pass_ms = 0.0f;
+		aq->pass_frames = 0;
+	}
+
+	enum quality_level level = previous;
+	if (pressure) {
+		aq->healthy = 0;
+		if (level < QUALITY_DIRECT_CUT)
+			level++;
+	} else if (judged && level > QUALITY_FULL &&
+		   ++aq->healthy >= QUALITY_RECOVER_INTERVALS) {
+		aq->healthy = 0;
+		level--;
+	}
+
+	if (level == previous)
+		return false;
+	os_atomic_set_long(&aq->level, level);
+	clear_window(aq);
+
+	blog(LOG_INFO,
+	     "[Browser Transition] '%s' quality %s -> %s (lagged %u, skipped %u, passes %.2f ms)",
+	     name, quality_level_names[previous],
+	     quality_level_names[level], new_lagged, new_skipped, avg_ms);
+	return true;
+}
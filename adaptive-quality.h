@@ -0,0 +1,49 @@
+#pragma once
+
+#include "obs-module.h"
+#include <util/threading.h>
+
+/*
+ * Steps the transition down one quality level at a time while OBS lags or
+ * skips frames, or while the transition passes use too much of the frame
+ * budget, and back up once there has been headroom for a while.
+ */
+
+enum quality_level {
+	QUALITY_FULL,
+	QUALITY_HALF_MATTE,
+	QUALITY_HALF_BROWSER,
+	QUALITY_LOW_FPS,
+	QUALITY_DIRECT_CUT,
+};
+
+struct adaptive_quality {
+	volatile long level;
+	volatile bool reset;
+	uint32_t last_lagged;
+	uint32_t last_skipped;
+	float elapsed;
+	int healthy;
+	/* pass times of the frames rendered at the current level */
+	float pass_ms;
+	uint32_t pass_frames;
+};
+
+static inline enum quality_level
+adaptive_quality_get_level(const struct adaptive_quality *aq)
+{
+	return (enum quality_level)os_atomic_load_long(&aq->level);
+}
+
+/* any thread, the counters are reset on the next tick */
+void adaptive_quality_reset(struct adaptive_quality *aq);
+
+/* graphics thread, call every video_tick; only the time spent
+ * transitioning at the current level counts, lag while idle isn't caused
+ * by the transition. rendered is the level the frames were rendered at,
+ * pass_ms the sum of the pass times of the pass_frames frames timed since
+ * the last tick. returns true when the level changed */
+bool adaptive_quality_tick(struct adaptive_quality *aq, float seconds,
+			   bool transitioning, enum quality_level rendered,
+			   float pass_ms, uint32_t pass_frames,
+			   const char *name);
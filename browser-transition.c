@@ -1,30 +1,67 @@
 
 #include "obs-module.h"
 #include "version.h"
+#include <util/platform.h>
+#include <util/threading.h>
+#include "adaptive-quality.h"
+#include "frame-ring.h"
+#include "matte-coverage.h"
+#include "render-timing.h"
+#include "trace.h"
+#include "transition-schedule.h"
 
 #define LOG_OFFSET_DB 6.0f
 #define LOG_RANGE_DB 96.0f
+#define FADE_POINT_SCALE 1000000.0f
 enum matte_layout {
 	MATTE_LAYOUT_HORIZONTAL,
 	MATTE_LAYOUT_VERTICAL,
 	MATTE_LAYOUT_MASK,
 };
 
+enum audio_fade_style {
+	AUDIO_FADE_IN_OUT,
+	AUDIO_FADE_CROSS,
+	AUDIO_FADE_MATTE,
+};
+
+enum matte_source_type {
+	MATTE_SOURCE_BROWSER,
+	MATTE_SOURCE_FILE,
+	MATTE_SOURCE_SOURCE,
+	MATTE_SOURCE_PAGE,
+};
+
 struct browser_transition {
 	obs_source_t *source;
 	obs_source_t *browser;
+	obs_source_t *matte_file_source;
+	obs_source_t *matte_browser;
+	obs_weak_source_t *matte_weak_source;
+	obs_source_t *active_matte;
 	bool transitioning;
+	bool browser_active;
 	float transition_point;
-	obs_transition_audio_mix_callback_t mix_a;
-	obs_transition_audio_mix_callback_t mix_b;
-	float transition_a_mul;
-	float transition_b_mul;
+	/* read by the audio thread while update and start run elsewhere, so
+	 * it is only ever swapped as a whole */
+	volatile long audio_fade;
+	/* start writes the schedule, render and the audio thread copy it */
+	pthread_mutex_t schedule_mutex;
+	struct transition_schedule schedule;
+	struct transition_schedule audio_schedule;
+	/* transition point for the fades without a schedule */
+	volatile long fade_point;
 	float duration;
 	bool matte_rendered;
+	uint32_t canvas_cx;
+	uint32_t canvas_cy;
 	bool track_matte_enabled;
 	enum matte_layout matte_layout;
+	enum matte_source_type matte_source_type;
+	bool browser_needed;
 	float matte_width_factor;
 	float matte_height_factor;
+	float matte_browser_scale;
 
 	gs_effect_t *matte_effect;
 	gs_eparam_t *ep_a_tex;
@@ -35,10 +72,107 @@ struct browser_transition {
 	gs_texrender_t *matte_tex;
 	gs_texrender_t *stinger_tex;
 
+	struct render_timing *timing;
+	uint32_t trace_pid;
+	/* update turns it on and off while the other threads trace */
+	volatile bool tracing;
+	char *trace_path;
+	bool browser_ready;
+	struct matte_coverage *coverage;
+	struct frame_ring *jitter;
+	size_t jitter_depth;
+	/* the browser audio is delayed as far as the jitter buffer delays
+	 * the video, the delay line belongs to the audio thread */
+	volatile long audio_delay;
+	volatile bool audio_delay_reset;
+	float *audio_delay_buf;
+	size_t audio_delay_len;
+	size_t audio_delay_pos;
+	bool matte_audio;
+	/* stop reads it on the graphics thread, for the browser fps */
+	volatile bool adaptive;
+	struct adaptive_quality quality;
+	/* browser size, fps and direct cut only change between transitions */
+	enum quality_level start_quality;
+
 	bool invert_matte;
 	bool do_texrender;
 };
 
+static inline bool is_tracing(const struct browser_transition *bt)
+{
+	return os_atomic_load_bool(&bt->tracing);
+}
+
+static inline uint64_t trace_begin(const struct browser_transition *bt)
+{
+	return is_tracing(bt) && trace_active() ? os_gettime_ns() : 0;
+}
+
+static inline void trace_end(const struct browser_transition *bt,
+			     const char *name, uint64_t begin)
+{
+	if (begin)
+		trace_complete(bt->trace_pid, name, begin, os_gettime_ns());
+}
+
+static void call_javascript_event(obs_source_t *browser,
+				  const char *event_name, const char *json)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(browser);
+	if (!ph)
+		return;
+	struct calldata cd = {0};
+	calldata_set_string(&cd, "eventName", event_name);
+	if (json)
+		calldata_set_string(&cd, "jsonString", json);
+	proc_handler_call(ph, "javascript_event", &cd);
+	calldata_free(&cd);
+}
+
+static void send_javascript_event(struct browser_transition *bt,
+				  const char *event_name, const char *json)
+{
+	call_javascript_event(bt->browser, event_name, json);
+	/* the matte page gets the same events to stay in sync */
+	if (bt->matte_browser && bt->matte_source_type == MATTE_SOURCE_PAGE)
+		call_javascript_event(bt->matte_browser, event_name, json);
+	if (is_tracing(bt))
+		trace_instant(bt->trace_pid, "javascript_event", event_name);
+}
+
+static inline enum quality_level get_quality(struct browser_transition *bt)
+{
+	return os_atomic_load_bool(&bt->adaptive)
+		       ? adaptive_quality_get_level(&bt->quality)
+		       : QUALITY_FULL;
+}
+
+/* a half resolution matte applies right away, the other levels only from
+ * the next start */
+static enum quality_level
+get_rendered_quality(struct browser_transition *bt)
+{
+	const enum quality_level level = get_quality(bt);
+	if (bt->start_quality <= QUALITY_HALF_MATTE &&
+	    level <= QUALITY_HALF_MATTE)
+		return level;
+	return bt->start_quality;
+}
+
+static void browser_transition_get_render_stats(void *data, calldata_t *cd)
+{
+	struct browser_transition *bt = data;
+	obs_data_t *stats = obs_data_create();
+	render_timing_get_stats(bt->timing, stats);
+	obs_data_set_int(stats, "qualityLevel", get_quality(bt));
+	obs_enter_graphics();
+	frame_ring_get_stats(bt->jitter, stats);
+	obs_leave_graphics();
+	calldata_set_string(cd, "json", obs_data_get_json(stats));
+	obs_data_release(stats);
+}
+
 static void *browser_transition_create(obs_data_t *settings,
 				       obs_source_t *source)
 {
@@ -46,6 +180,7 @@ static void *browser_transition_create(obs_data_t *settings,
 	struct browser_transition *bt =
 		bzalloc(sizeof(struct browser_transition));
 	bt->source = source;
+	bt->trace_pid = trace_new_pid();
 	bt->browser = obs_source_create_private(
 		"browser_source", obs_source_get_name(source), NULL);
 	char *effect_file = obs_module_file("effects/matte_transition.effect");
@@ -53,6 +188,10 @@ static void *browser_transition_create(obs_data_t *settings,
 	obs_enter_graphics();
 	bt->matte_effect =
 		gs_effect_create_from_file(effect_file, &error_string);
+	if (bt->matte_effect) {
+		bt->timing = render_timing_create();
+		bt->coverage = matte_coverage_create();
+	}
 	obs_leave_graphics();
 
 	bfree(effect_file);
@@ -61,9 +200,12 @@ static void *browser_transition_create(obs_data_t *settings,
 		blog(LOG_ERROR, "Could not open matte_transition.effect: %s",
 		     error_string);
 		bfree(error_string);
+		obs_source_release(bt->browser);
 		bfree(bt);
 		return NULL;
 	}
+	bfree(error_string);
+	pthread_mutex_init(&bt->schedule_mutex, NULL);
 
 	bt->ep_a_tex = gs_effect_get_param_by_name(bt->matte_effect, "a_tex");
 	bt->ep_b_tex = gs_effect_get_param_by_name(bt->matte_effect, "b_tex");
@@ -72,6 +214,10 @@ static void *browser_transition_create(obs_data_t *settings,
 	bt->ep_invert_matte =
 		gs_effect_get_param_by_name(bt->matte_effect, "invert_matte");
 
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_add(ph, "void get_render_stats(out string json)",
+			 browser_transition_get_render_stats, bt);
+
 	obs_transition_enable_fixed(bt->source, true, 0);
 	obs_source_update(source, NULL);
 	return bt;
@@ -79,7 +225,13 @@ static void *browser_transition_create(obs_data_t *settings,
 
 void browser_transition_destroy(void *data)
 {
-	const struct browser_transition *browser_transition = data;
+	struct browser_transition *browser_transition = data;
+	if (is_tracing(browser_transition))
+		trace_stop();
+	obs_source_release(browser_transition->active_matte);
+	obs_source_release(browser_transition->matte_file_source);
+	obs_source_release(browser_transition->matte_browser);
+	obs_weak_source_release(browser_transition->matte_weak_source);
 	obs_source_release(browser_transition->browser);
 
 	obs_enter_graphics();
@@ -87,8 +239,14 @@ void browser_transition_destroy(void *data)
 	gs_texrender_destroy(browser_transition->matte_tex);
 	gs_texrender_destroy(browser_transition->stinger_tex);
 	gs_effect_destroy(browser_transition->matte_effect);
+	render_timing_destroy(browser_transition->timing);
+	matte_coverage_destroy(browser_transition->coverage);
+	frame_ring_destroy(browser_transition->jitter);
 
 	obs_leave_graphics();
+	pthread_mutex_destroy(&browser_transition->schedule_mutex);
+	bfree(browser_transition->trace_path);
+	bfree(browser_transition->audio_delay_buf);
 	bfree(data);
 }
 
@@ -104,16 +262,35 @@ static inline float calc_fade(float t, float mul)
 	return t > 1.0f ? 1.0f : t;
 }
 
+static void get_schedule(struct browser_transition *bt,
+			 struct transition_schedule *schedule)
+{
+	pthread_mutex_lock(&bt->schedule_mutex);
+	*schedule = bt->schedule;
+	pthread_mutex_unlock(&bt->schedule_mutex);
+}
+
+static inline float get_fade_point(struct browser_transition *bt)
+{
+	return (float)os_atomic_load_long(&bt->fade_point) / FADE_POINT_SCALE;
+}
+
 static float mix_a_fade_in_out(void *data, float t)
 {
 	struct browser_transition *s = data;
-	return 1.0f - calc_fade(t, s->transition_a_mul);
+	const struct transition_schedule *schedule = &s->audio_schedule;
+	if (schedule->valid)
+		return transition_schedule_fade_a(schedule, t);
+	return 1.0f - calc_fade(t, 1.0f / get_fade_point(s));
 }
 
 static float mix_b_fade_in_out(void *data, float t)
 {
 	struct browser_transition *s = data;
-	return 1.0f - calc_fade(1.0f - t, s->transition_b_mul);
+	const struct transition_schedule *schedule = &s->audio_schedule;
+	if (schedule->valid)
+		return transition_schedule_fade_b(schedule, t);
+	return 1.0f - calc_fade(1.0f - t, 1.0f / (1.0f - get_fade_point(s)));
 }
 
 static float mix_a_cross_fade(void *data, float t)
@@ -128,60 +305,366 @@ static float mix_b_cross_fade(void *data, float t)
 	return t;
 }
 
+static float mix_a_matte(void *data, float t)
+{
+	struct browser_transition *s = data;
+	float coverage;
+	if (t >= 1.0f)
+		return 0.0f;
+	if (!matte_coverage_get(s->coverage, &coverage))
+		return 1.0f - t;
+	return 1.0f - coverage;
+}
+
+static float mix_b_matte(void *data, float t)
+{
+	struct browser_transition *s = data;
+	float coverage;
+	if (t >= 1.0f)
+		return 1.0f;
+	if (!matte_coverage_get(s->coverage, &coverage))
+		return t;
+	return coverage;
+}
+
+struct audio_fade {
+	obs_transition_audio_mix_callback_t mix_a;
+	obs_transition_audio_mix_callback_t mix_b;
+};
+
+static const struct audio_fade audio_fades[] = {
+	[AUDIO_FADE_IN_OUT] = {mix_a_fade_in_out, mix_b_fade_in_out},
+	[AUDIO_FADE_CROSS] = {mix_a_cross_fade, mix_b_cross_fade},
+	[AUDIO_FADE_MATTE] = {mix_a_matte, mix_b_matte},
+};
+
+static obs_source_t *get_matte_source(struct browser_transition *bt)
+{
+	switch (bt->matte_source_type) {
+	case MATTE_SOURCE_FILE:
+		return obs_source_get_ref(bt->matte_file_source);
+	case MATTE_SOURCE_SOURCE:
+		return obs_weak_source_get_source(bt->matte_weak_source);
+	case MATTE_SOURCE_PAGE:
+		return obs_source_get_ref(bt->matte_browser);
+	default:
+		return obs_source_get_ref(bt->browser);
+	}
+}
+
+/* an existing source belongs to the user and may be shown elsewhere, only
+ * the mattes created here are rewound for a transition */
+static void restart_matte(struct browser_transition *bt, obs_source_t *matte)
+{
+	if (bt->matte_source_type != MATTE_SOURCE_SOURCE)
+		obs_source_media_restart(matte);
+}
+
+static void add_active_children(struct browser_transition *bt)
+{
+	if (bt->transitioning)
+		return;
+	bt->transitioning = true;
+
+	/* a direct cut only renders the sources */
+	if (bt->start_quality >= QUALITY_DIRECT_CUT)
+		return;
+
+	if (bt->browser_needed) {
+		obs_source_add_active_child(bt->source, bt->browser);
+		bt->browser_active = true;
+	}
+
+	if (bt->track_matte_enabled &&
+	    bt->matte_source_type != MATTE_SOURCE_BROWSER) {
+		obs_source_t *matte = get_matte_source(bt);
+		if (matte && obs_source_add_active_child(bt->source, matte)) {
+			restart_matte(bt, matte);
+			bt->active_matte = matte;
+		} else {
+			obs_source_release(matte);
+		}
+	}
+}
+
+static void remove_active_children(struct browser_transition *bt)
+{
+	if (!bt->transitioning)
+		return;
+	bt->transitioning = false;
+
+	if (bt->browser_active) {
+		obs_source_remove_active_child(bt->source, bt->browser);
+		bt->browser_active = false;
+	}
+	if (bt->active_matte) {
+		obs_source_remove_active_child(bt->source, bt->active_matte);
+		obs_source_release(bt->active_matte);
+		bt->active_matte = NULL;
+	}
+}
+
+static void update_matte_source(struct browser_transition *bt,
+				obs_data_t *settings,
+				enum matte_source_type type)
+{
+	obs_source_t *old_file_source = NULL;
+
+	if (type == MATTE_SOURCE_FILE) {
+		const char *file =
+			obs_data_get_string(settings, "track_matte_file");
+		obs_data_t *ms = obs_data_create();
+		obs_data_set_bool(ms, "is_local_file", true);
+		obs_data_set_string(ms, "local_file", file);
+		obs_data_set_bool(ms, "looping", false);
+		obs_data_set_bool(ms, "restart_on_activate", true);
+		if (bt->matte_file_source) {
+			obs_source_update(bt->matte_file_source, ms);
+		} else if (file && *file) {
+			obs_source_t *matte = obs_source_create_private(
+				"ffmpeg_source", obs_source_get_name(bt->source),
+				ms);
+			obs_enter_graphics();
+			bt->matte_file_source = matte;
+			obs_leave_graphics();
+		}
+		obs_data_release(ms);
+	} else if (bt->matte_file_source) {
+		obs_enter_graphics();
+		old_file_source = bt->matte_file_source;
+		bt->matte_file_source = NULL;
+		obs_leave_graphics();
+	}
+	obs_source_release(old_file_source);
+
+	obs_source_t *old_matte_browser = NULL;
+	bt->matte_browser_scale =
+		(float)obs_data_get_int(settings, "track_matte_scale") / 100.0f;
+	if (type == MATTE_SOURCE_PAGE) {
+		const char *url =
+			obs_data_get_string(settings, "track_matte_url");
+		obs_data_t *ms = obs_data_create();
+		obs_data_set_bool(ms, "is_local_file", false);
+		obs_data_set_string(ms, "url", url);
+		obs_data_set_bool(ms, "fps_custom", true);
+		obs_data_set_int(ms, "fps",
+				 obs_data_get_int(settings, "track_matte_fps"));
+		obs_data_set_bool(ms, "reroute_audio", false);
+		const uint32_t cx = obs_source_get_width(bt->source);
+		const uint32_t cy = obs_source_get_height(bt->source);
+		if (cx && cy) {
+			obs_data_set_int(ms, "width",
+					 (uint32_t)((float)cx *
+						    bt->matte_browser_scale));
+			obs_data_set_int(ms, "height",
+					 (uint32_t)((float)cy *
+						    bt->matte_browser_scale));
+		}
+		if (bt->matte_browser) {
+			obs_source_update(bt->matte_browser, ms);
+		} else if (url && *url) {
+			obs_source_t *matte = obs_source_create_private(
+				"browser_source",
+				obs_source_get_name(bt->source), ms);
+			obs_source_set_muted(matte, true);
+			obs_enter_graphics();
+			bt->matte_browser = matte;
+			obs_leave_graphics();
+		}
+		obs_data_release(ms);
+	} else if (bt->matte_browser) {
+		obs_enter_graphics();
+		old_matte_browser = bt->matte_browser;
+		bt->matte_browser = NULL;
+		obs_leave_graphics();
+	}
+	obs_source_release(old_matte_browser);
+
+	const char *name = obs_data_get_string(settings, "track_matte_source");
+	obs_weak_source_t *weak = NULL;
+	if (type == MATTE_SOURCE_SOURCE && name && *name) {
+		obs_source_t *matte = obs_get_source_by_name(name);
+		if (matte && matte != bt->source)
+			weak = obs_source_get_weak_source(matte);
+		obs_source_release(matte);
+	}
+	obs_enter_graphics();
+	obs_weak_source_t *old_weak = bt->matte_weak_source;
+	bt->matte_weak_source = weak;
+	obs_leave_graphics();
+	obs_weak_source_release(old_weak);
+}
+
+static void update_browser_fps(struct browser_transition *bt)
+{
+	obs_data_t *settings = obs_source_get_settings(bt->source);
+	obs_data_t *s = obs_source_get_settings(bt->browser);
+	if (!settings || !s) {
+		obs_data_release(settings);
+		obs_data_release(s);
+		return;
+	}
+
+	bool fps_custom = obs_data_get_bool(settings, "fps_custom");
+	long long fps = obs_data_get_int(settings, "fps");
+	if (get_quality(bt) >= QUALITY_LOW_FPS) {
+		struct obs_video_info ovi = {0};
+		if (!fps_custom && obs_get_video_info(&ovi) && ovi.fps_den)
+			fps = ovi.fps_num / ovi.fps_den;
+		fps_custom = true;
+		fps = fps > 1 ? fps / 2 : 1;
+	}
+
+	/* changing the fps reloads the page, so this only runs after a
+	 * transition has finished */
+	if (fps_custom != obs_data_get_bool(s, "fps_custom") ||
+	    fps != obs_data_get_int(s, "fps")) {
+		obs_data_set_bool(s, "fps_custom", fps_custom);
+		obs_data_set_int(s, "fps", fps);
+		obs_source_update(bt->browser, NULL);
+		if (is_tracing(bt))
+			trace_instant(bt->trace_pid, "browser_fps", "stop");
+	}
+	obs_data_release(s);
+	obs_data_release(settings);
+}
+
+/* the jitter buffer shows the stinger this much later */
+static double jitter_delay_ms(const struct browser_transition *bt)
+{
+	struct obs_video_info ovi = {0};
+	if (!bt->jitter_depth || !obs_get_video_info(&ovi) || !ovi.fps_num)
+		return 0.0;
+	return (double)bt->jitter_depth * 1000.0 * (double)ovi.fps_den /
+	       (double)ovi.fps_num;
+}
+
+/* frames per browser paint, repeated pictures within one aren't stalls */
+static uint32_t browser_frame_interval(struct browser_transition *bt)
+{
+	struct obs_video_info ovi = {0};
+	obs_data_t *s = obs_source_get_settings(bt->browser);
+	uint32_t interval = 1;
+	if (s && obs_data_get_bool(s, "fps_custom") &&
+	    obs_get_video_info(&ovi) && ovi.fps_den) {
+		const long long fps = obs_data_get_int(s, "fps");
+		if (fps > 0)
+			interval = (uint32_t)((double)ovi.fps_num /
+					      ovi.fps_den / (double)fps + 0.5);
+	}
+	obs_data_release(s);
+	return interval ? interval : 1;
+}
+
 void browser_transition_update(void *data, obs_data_t *settings)
 {
 	struct browser_transition *browser_transition = data;
+	const uint64_t trace_time = trace_begin(browser_transition);
 
-	browser_transition->duration =
-		(float)obs_data_get_double(settings, "duration");
-	obs_transition_enable_fixed(browser_transition->source, true,
-				    (uint32_t)browser_transition->duration);
-
+	const float duration = (float)obs_data_get_double(settings, "duration");
+	float transition_point = browser_transition->transition_point;
 	const bool time_based_transition_point =
 		obs_data_get_int(settings, "tp_type") == 1;
 	if (time_based_transition_point) {
 		const float transition_point_ms = (float)obs_data_get_double(
 			settings, "transition_point_ms");
-		if (browser_transition->duration > 0.0f)
-			browser_transition->transition_point =
-				transition_point_ms /
-				browser_transition->duration;
+		if (duration > 0.0f)
+			transition_point = transition_point_ms / duration;
 	} else {
-		browser_transition->transition_point =
-			(float)obs_data_get_double(settings,
-						   "transition_point") /
-			100.0f;
+		transition_point = (float)obs_data_get_double(
+					   settings, "transition_point") /
+				   100.0f;
 	}
 
-	bool track_matte_was_enabled = browser_transition->track_matte_enabled;
-
-	browser_transition->track_matte_enabled =
+	const bool track_matte_enabled =
 		obs_data_get_bool(settings, "track_matte_enabled");
-	browser_transition->matte_layout =
+	const enum matte_layout matte_layout =
 		(int)obs_data_get_int(settings, "track_matte_layout");
+	const enum matte_source_type matte_source_type =
+		(int)obs_data_get_int(settings, "track_matte_source_type");
+	update_matte_source(browser_transition, settings, matte_source_type);
+
+	/* the browser only packs the matte next to the stinger when it is
+	 * the matte source itself */
+	const bool packed_matte = track_matte_enabled &&
+				  matte_source_type == MATTE_SOURCE_BROWSER;
+
+	/* a matte from another source would run ahead of the buffered
+	 * stinger, so only a browser that carries its own matte is buffered */
+	const size_t jitter_depth =
+		packed_matte || !track_matte_enabled
+			? (size_t)obs_data_get_int(settings, "jitter_buffer")
+			: 0;
+	const bool adaptive = obs_data_get_bool(settings, "adaptive_quality");
+
+	long audio_fade_style =
+		(long)obs_data_get_int(settings, "audio_fade_style");
+	if (audio_fade_style < AUDIO_FADE_IN_OUT ||
+	    audio_fade_style > AUDIO_FADE_MATTE)
+		audio_fade_style = AUDIO_FADE_IN_OUT;
+	const bool matte_audio = audio_fade_style == AUDIO_FADE_MATTE &&
+				 track_matte_enabled;
+	if (audio_fade_style == AUDIO_FADE_MATTE && !matte_audio)
+		audio_fade_style = AUDIO_FADE_CROSS;
+
+	/* render reads all of this at once, so a frame sees either the old
+	 * or the new settings together with the texrenders they need */
+	obs_enter_graphics();
+
+	/* settings may have changed, next start can't reuse the geometry */
+	browser_transition->canvas_cx = 0;
+	browser_transition->canvas_cy = 0;
+	browser_transition->duration = duration;
+	browser_transition->transition_point = transition_point;
+	os_atomic_set_long(&browser_transition->fade_point,
+			   (long)(transition_point * FADE_POINT_SCALE));
+
+	if (track_matte_enabled != browser_transition->track_matte_enabled) {
+		gs_texrender_destroy(browser_transition->matte_tex);
+		gs_texrender_destroy(browser_transition->stinger_tex);
+		browser_transition->matte_tex = NULL;
+		browser_transition->stinger_tex = NULL;
+
+		if (track_matte_enabled) {
+			browser_transition->matte_tex =
+				gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+			browser_transition->stinger_tex =
+				gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		}
+	}
+	browser_transition->track_matte_enabled = track_matte_enabled;
+	browser_transition->matte_layout = matte_layout;
+	browser_transition->matte_source_type = matte_source_type;
 	browser_transition->matte_width_factor =
-		(browser_transition->track_matte_enabled &&
-				 browser_transition->matte_layout ==
-					 MATTE_LAYOUT_HORIZONTAL
-			 ? 2.0f
-			 : 1.0f);
+		packed_matte && matte_layout == MATTE_LAYOUT_HORIZONTAL ? 2.0f
+									: 1.0f;
 	browser_transition->matte_height_factor =
-		(browser_transition->track_matte_enabled &&
-				 browser_transition->matte_layout ==
-					 MATTE_LAYOUT_VERTICAL
-			 ? 2.0f
-			 : 1.0f);
+		packed_matte && matte_layout == MATTE_LAYOUT_VERTICAL ? 2.0f
+								      : 1.0f;
 	browser_transition->invert_matte =
 		obs_data_get_bool(settings, "invert_matte");
-
 	browser_transition->do_texrender =
-		browser_transition->track_matte_enabled &&
-		browser_transition->matte_layout < MATTE_LAYOUT_MASK;
+		packed_matte && matte_layout < MATTE_LAYOUT_MASK;
+	browser_transition->browser_needed = !track_matte_enabled ||
+					     packed_matte ||
+					     matte_layout != MATTE_LAYOUT_MASK;
+	browser_transition->matte_audio = matte_audio;
+
+	const bool adaptive_changed = adaptive != browser_transition->adaptive;
+	if (adaptive_changed) {
+		adaptive_quality_reset(&browser_transition->quality);
+		os_atomic_set_bool(&browser_transition->adaptive, adaptive);
+	}
+	const bool idle = !browser_transition->transitioning;
 
-	browser_transition->transition_a_mul =
-		(1.0f / browser_transition->transition_point);
-	browser_transition->transition_b_mul =
-		(1.0f / (1.0f - browser_transition->transition_point));
+	if (jitter_depth != browser_transition->jitter_depth) {
+		frame_ring_destroy(browser_transition->jitter);
+		browser_transition->jitter =
+			jitter_depth ? frame_ring_create(jitter_depth) : NULL;
+		browser_transition->jitter_depth = jitter_depth;
+	}
+
+	obs_leave_graphics();
 
 	obs_source_set_monitoring_type(browser_transition->browser,
 				       obs_data_get_int(settings,
@@ -201,13 +684,7 @@ void browser_transition_update(void *data, obs_data_t *settings)
 		     LOG_OFFSET_DB;
 	const float mul = obs_db_to_mul(db);
 	obs_source_set_volume(browser_transition->browser, mul);
-	if (!obs_data_get_int(settings, "audio_fade_style")) {
-		browser_transition->mix_a = mix_a_fade_in_out;
-		browser_transition->mix_b = mix_b_fade_in_out;
-	} else {
-		browser_transition->mix_a = mix_a_cross_fade;
-		browser_transition->mix_b = mix_b_cross_fade;
-	}
+	os_atomic_set_long(&browser_transition->audio_fade, audio_fade_style);
 	obs_source_update(browser_transition->browser, settings);
 
 	obs_data_t *s = obs_source_get_settings(browser_transition->browser);
@@ -225,28 +702,72 @@ void browser_transition_update(void *data, obs_data_t *settings)
 			obs_data_set_int(s, "width", cx);
 			obs_data_set_int(s, "height", cy);
 			obs_source_update(browser_transition->browser, NULL);
+			if (is_tracing(browser_transition))
+				trace_instant(browser_transition->trace_pid,
+					      "browser_resize", "update");
 		}
 		obs_data_release(s);
 	}
 
-	if (browser_transition->track_matte_enabled !=
-	    track_matte_was_enabled) {
-		obs_enter_graphics();
-
-		gs_texrender_destroy(browser_transition->matte_tex);
-		gs_texrender_destroy(browser_transition->stinger_tex);
-		browser_transition->matte_tex = NULL;
-		browser_transition->stinger_tex = NULL;
+	/* put a lowered browser fps back right away, stop does it otherwise */
+	if (adaptive_changed && idle)
+		update_browser_fps(browser_transition);
+
+	/* the transition runs longer by the buffered frames so the end of the
+	 * stinger isn't cut off */
+	const double delay_ms = jitter_delay_ms(browser_transition);
+	obs_transition_enable_fixed(
+		browser_transition->source, true,
+		(uint32_t)((double)browser_transition->duration + delay_ms));
+	struct obs_audio_info oai = {0};
+	obs_get_audio_info(&oai);
+	os_atomic_set_long(&browser_transition->audio_delay,
+			   (long)(delay_ms * oai.samples_per_sec / 1000.0 + 0.5));
+
+	/* another file needs a new trace, which fails while a different
+	 * transition is tracing to a file of its own */
+	const bool tracing = obs_data_get_bool(settings, "trace_enabled");
+	const char *trace_path = obs_data_get_string(settings, "trace_file");
+	if (is_tracing(browser_transition) &&
+	    (!tracing || strcmp(trace_path, browser_transition->trace_path))) {
+		os_atomic_set_bool(&browser_transition->tracing, false);
+		trace_stop();
+	}
+	if (tracing && !is_tracing(browser_transition) &&
+	    trace_start(trace_path)) {
+		bfree(browser_transition->trace_path);
+		browser_transition->trace_path = bstrdup(trace_path);
+		os_atomic_set_bool(&browser_transition->tracing, true);
+	}
+	if (is_tracing(browser_transition))
+		trace_set_process_name(
+			browser_transition->trace_pid,
+			obs_source_get_name(browser_transition->source));
+	trace_end(browser_transition, "update", trace_time);
+}
 
-		if (browser_transition->track_matte_enabled) {
-			browser_transition->matte_tex =
-				gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-			browser_transition->stinger_tex =
-				gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-		}
+static bool browser_frame_ready(struct browser_transition *bt)
+{
+	return !bt->jitter || frame_ring_get(bt->jitter);
+}
 
-		obs_leave_graphics();
+static void render_browser(struct browser_transition *bt)
+{
+	gs_texture_t *tex = frame_ring_get(bt->jitter);
+	if (!tex) {
+		obs_source_video_render(bt->browser);
+		return;
 	}
+
+	gs_effect_t *e = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t *p_image = gs_effect_get_param_by_name(e, "image");
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+	gs_effect_set_texture_srgb(p_image, tex);
+	while (gs_effect_loop(e, "Draw"))
+		gs_draw_sprite(tex, 0, gs_texture_get_width(tex),
+			       gs_texture_get_height(tex));
+	gs_enable_framebuffer_srgb(previous);
 }
 
 void browser_transition_matte_render(void *data, gs_texture_t *a,
@@ -257,18 +778,19 @@ void browser_transition_matte_render(void *data, gs_texture_t *a,
 	struct vec4 background;
 	vec4_zero(&background);
 
-	obs_source_t *matte_source = s->browser;
+	obs_source_t *matte_source = get_matte_source(s);
+	if (!matte_source)
+		return;
 
 	float matte_cx = (float)obs_source_get_width(matte_source) /
 			 s->matte_width_factor;
 	float matte_cy = (float)obs_source_get_height(matte_source) /
 			 s->matte_height_factor;
 
-	float width_offset = (s->matte_layout == MATTE_LAYOUT_HORIZONTAL
-				      ? (-matte_cx)
-				      : 0.0f);
-	float height_offset =
-		(s->matte_layout == MATTE_LAYOUT_VERTICAL ? (-matte_cy) : 0.0f);
+	float width_offset = (s->matte_width_factor > 1.0f ? (-matte_cx)
+							   : 0.0f);
+	float height_offset = (s->matte_height_factor > 1.0f ? (-matte_cy)
+							     : 0.0f);
 
 	// Track matte media render
 	if (matte_cx > 0 && matte_cy > 0) {
@@ -283,8 +805,16 @@ void browser_transition_matte_render(void *data, gs_texture_t *a,
 			s->matte_tex = gs_texrender_create(format, GS_ZS_NONE);
 		}
 
-		if (gs_texrender_begin_with_color_space(s->matte_tex, cx, cy,
-							space)) {
+		/* the composite samples the matte with uv, so it can be
+		 * rendered smaller than the canvas */
+		const uint32_t shift =
+			get_quality(s) >= QUALITY_HALF_MATTE ? 1 : 0;
+		const uint32_t tex_cx = cx > 1 ? cx >> shift : cx;
+		const uint32_t tex_cy = cy > 1 ? cy >> shift : cy;
+
+		render_timing_pass_begin(s->timing, RENDER_PASS_MATTE);
+		if (gs_texrender_begin_with_color_space(s->matte_tex, tex_cx,
+							tex_cy, space)) {
 			gs_matrix_scale3f(scale_x, scale_y, 1.0f);
 			gs_matrix_translate3f(width_offset, height_offset,
 					      0.0f);
@@ -292,11 +822,27 @@ void browser_transition_matte_render(void *data, gs_texture_t *a,
 			gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f,
 				 100.0f);
 
-			obs_source_video_render(matte_source);
+			if (matte_source == s->browser)
+				render_browser(s);
+			else
+				obs_source_video_render(matte_source);
 
 			gs_texrender_end(s->matte_tex);
 		}
+		render_timing_pass_end(s->timing, RENDER_PASS_MATTE);
+
+		if (s->matte_audio) {
+			const uint64_t latency = matte_coverage_update(
+				s->coverage,
+				gs_texrender_get_texture(s->matte_tex),
+				s->invert_matte);
+			if (latency)
+				render_timing_add_cpu(s->timing,
+						      RENDER_CPU_READBACK,
+						      latency);
+		}
 	}
+	obs_source_release(matte_source);
 
 	const bool previous = gs_framebuffer_srgb_enabled();
 	gs_enable_framebuffer_srgb(true);
@@ -317,8 +863,10 @@ void browser_transition_matte_render(void *data, gs_texture_t *a,
 			      gs_texrender_get_texture(s->matte_tex));
 	gs_effect_set_bool(s->ep_invert_matte, s->invert_matte);
 
+	render_timing_pass_begin(s->timing, RENDER_PASS_COMPOSITE);
 	while (gs_effect_loop(s->matte_effect, tech_name))
 		gs_draw_sprite(NULL, 0, cx, cy);
+	render_timing_pass_end(s->timing, RENDER_PASS_COMPOSITE);
 
 	gs_enable_framebuffer_srgb(previous);
 
@@ -335,6 +883,7 @@ static void stinger_texrender(struct browser_transition *s, uint32_t source_cx,
 		s->stinger_tex = gs_texrender_create(format, GS_ZS_NONE);
 	}
 
+	render_timing_pass_begin(s->timing, RENDER_PASS_STINGER);
 	if (gs_texrender_begin_with_color_space(s->stinger_tex, source_cx,
 						source_cy, space)) {
 		float cx = (float)media_cx / s->matte_width_factor;
@@ -344,11 +893,12 @@ static void stinger_texrender(struct browser_transition *s, uint32_t source_cx,
 
 		gs_blend_state_push();
 		gs_enable_blending(false);
-		obs_source_video_render(s->browser);
+		render_browser(s);
 		gs_blend_state_pop();
 
 		gs_texrender_end(s->stinger_tex);
 	}
+	render_timing_pass_end(s->timing, RENDER_PASS_STINGER);
 }
 
 static const char *
@@ -391,7 +941,7 @@ get_tech_name_and_multiplier(enum gs_color_space current_space,
 	return tech_name;
 }
 
-void browser_transition_video_render(void *data, gs_effect_t *effect)
+static void browser_transition_render(void *data, gs_effect_t *effect)
 {
 	UNUSED_PARAMETER(effect);
 	struct browser_transition *browser_transition = data;
@@ -400,10 +950,16 @@ void browser_transition_video_render(void *data, gs_effect_t *effect)
 	const uint32_t media_cy =
 		obs_source_get_height(browser_transition->browser);
 	float t = obs_transition_get_time(browser_transition->source);
-	if (browser_transition->track_matte_enabled) {
-		const bool ready =
-			obs_source_active(browser_transition->browser) &&
-			!!media_cx && !!media_cy;
+	const bool direct_cut =
+		browser_transition->start_quality >= QUALITY_DIRECT_CUT;
+	if (browser_transition->track_matte_enabled && !direct_cut) {
+		obs_source_t *matte = get_matte_source(browser_transition);
+		const bool ready = matte && obs_source_active(matte) &&
+				   !!obs_source_get_width(matte) &&
+				   !!obs_source_get_height(matte) &&
+				   (matte != browser_transition->browser ||
+				    browser_frame_ready(browser_transition));
+		obs_source_release(matte);
 		if (ready) {
 			if (!browser_transition->matte_rendered)
 				browser_transition->matte_rendered = true;
@@ -418,19 +974,19 @@ void browser_transition_video_render(void *data, gs_effect_t *effect)
 					: OBS_TRANSITION_SOURCE_A);
 		}
 		if (t <= 0.0f || t >= 1.0f) {
-			if (browser_transition->transitioning) {
-				browser_transition->transitioning = false;
-				obs_source_remove_active_child(
-					browser_transition->source,
-					browser_transition->browser);
-			}
+			remove_active_children(browser_transition);
 			return;
 		}
 		if (browser_transition->matte_layout == MATTE_LAYOUT_MASK)
 			return;
 	} else {
 
-		const bool use_a = t < browser_transition->transition_point;
+		struct transition_schedule schedule;
+		get_schedule(browser_transition, &schedule);
+		const bool use_a =
+			schedule.valid
+				? transition_schedule_use_a(&schedule, t)
+				: t < browser_transition->transition_point;
 
 		enum obs_transition_target target =
 			use_a ? OBS_TRANSITION_SOURCE_A
@@ -438,14 +994,11 @@ void browser_transition_video_render(void *data, gs_effect_t *effect)
 
 		if (!obs_transition_video_render_direct(
 			    browser_transition->source, target)) {
-			if (browser_transition->transitioning) {
-				browser_transition->transitioning = false;
-				obs_source_remove_active_child(
-					browser_transition->source,
-					browser_transition->browser);
-			}
+			remove_active_children(browser_transition);
 			return;
 		}
+		if (direct_cut)
+			return;
 	}
 
 	/* --------------------- */
@@ -456,7 +1009,7 @@ void browser_transition_video_render(void *data, gs_effect_t *effect)
 	float source_cxf = (float)source_cx;
 	float source_cyf = (float)source_cy;
 
-	if (!media_cx || !media_cy)
+	if (!media_cx || !media_cy || !browser_frame_ready(browser_transition))
 		return;
 
 	if (browser_transition->do_texrender) {
@@ -481,8 +1034,12 @@ void browser_transition_video_render(void *data, gs_effect_t *effect)
 
 		gs_effect_set_texture_srgb(p_image, tex);
 		gs_effect_set_float(p_multiplier, multiplier);
+		render_timing_pass_begin(browser_transition->timing,
+					 RENDER_PASS_BROWSER);
 		while (gs_effect_loop(e, technique))
 			gs_draw_sprite(NULL, 0, source_cx, source_cy);
+		render_timing_pass_end(browser_transition->timing,
+				       RENDER_PASS_BROWSER);
 
 		gs_enable_framebuffer_srgb(previous);
 	} else {
@@ -490,17 +1047,121 @@ void browser_transition_video_render(void *data, gs_effect_t *effect)
 		gs_matrix_push();
 		gs_matrix_scale3f(source_cxf / (float)media_cx,
 				  source_cyf / (float)media_cy, 1.0f);
-		obs_source_video_render(browser_transition->browser);
+		render_timing_pass_begin(browser_transition->timing,
+					 RENDER_PASS_BROWSER);
+		render_browser(browser_transition);
+		render_timing_pass_end(browser_transition->timing,
+				       RENDER_PASS_BROWSER);
 		gs_matrix_pop();
 		gs_set_linear_srgb(previous);
 	}
 	UNUSED_PARAMETER(effect);
 }
 
-static bool browser_transition_audio_render(void *data, uint64_t *ts_out,
-					    struct obs_source_audio_mix *audio,
-					    uint32_t mixers, size_t channels,
-					    size_t sample_rate)
+static uint64_t texrender_size(gs_texrender_t *texrender)
+{
+	gs_texture_t *tex = gs_texrender_get_texture(texrender);
+	if (!tex)
+		return 0;
+	return (uint64_t)gs_texture_get_width(tex) *
+	       gs_texture_get_height(tex) *
+	       gs_get_format_bpp(gs_texture_get_color_format(tex)) / 8;
+}
+
+void browser_transition_video_render(void *data, gs_effect_t *effect)
+{
+	struct browser_transition *browser_transition = data;
+	const uint64_t trace_time = trace_begin(browser_transition);
+
+	if (is_tracing(browser_transition)) {
+		const bool ready =
+			obs_source_active(browser_transition->browser) &&
+			obs_source_get_width(browser_transition->browser) &&
+			obs_source_get_height(browser_transition->browser);
+		if (ready != browser_transition->browser_ready) {
+			browser_transition->browser_ready = ready;
+			trace_instant(browser_transition->trace_pid,
+				      "browser_ready",
+				      ready ? "true" : "false");
+		}
+	}
+
+	if (!browser_transition->transitioning) {
+		browser_transition_render(data, effect);
+		trace_end(browser_transition, "video_render", trace_time);
+		return;
+	}
+
+	frame_ring_update(browser_transition->jitter,
+			  browser_transition->browser);
+	render_timing_frame_begin(browser_transition->timing);
+	browser_transition_render(data, effect);
+	render_timing_set_vram(
+		browser_transition->timing,
+		texrender_size(browser_transition->matte_tex) +
+			texrender_size(browser_transition->stinger_tex) +
+			frame_ring_get_size(browser_transition->jitter) +
+			matte_coverage_get_size(browser_transition->coverage));
+	render_timing_frame_end(browser_transition->timing);
+	trace_end(browser_transition, "video_render", trace_time);
+}
+
+/* audio thread, (re)allocates the delay line when the delay changed */
+static bool prepare_audio_delay(struct browser_transition *bt)
+{
+	const size_t len = (size_t)os_atomic_load_long(&bt->audio_delay);
+	const bool reset = os_atomic_exchange_bool(&bt->audio_delay_reset,
+						   false);
+	if (len != bt->audio_delay_len) {
+		bfree(bt->audio_delay_buf);
+		bt->audio_delay_buf =
+			len ? bzalloc(sizeof(float) * len * MAX_AUDIO_MIXES *
+				      MAX_AUDIO_CHANNELS)
+			    : NULL;
+		bt->audio_delay_len = len;
+		bt->audio_delay_pos = 0;
+	} else if (reset && len) {
+		memset(bt->audio_delay_buf, 0,
+		       sizeof(float) * len * MAX_AUDIO_MIXES *
+			       MAX_AUDIO_CHANNELS);
+		bt->audio_delay_pos = 0;
+	}
+	return len != 0;
+}
+
+static void mix_delayed_audio(struct browser_transition *bt,
+			      struct obs_source_audio_mix *audio,
+			      const struct obs_source_audio_mix *child_audio,
+			      uint32_t mixers, size_t channels)
+{
+	const size_t len = bt->audio_delay_len;
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) == 0)
+			continue;
+
+		for (size_t ch = 0; ch < channels; ch++) {
+			float *out = audio->output[mix].data[ch];
+			const float *in = child_audio->output[mix].data[ch];
+			float *line = bt->audio_delay_buf +
+				      (mix * MAX_AUDIO_CHANNELS + ch) * len;
+			size_t pos = bt->audio_delay_pos;
+
+			for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i++) {
+				out[i] += line[pos];
+				line[pos] = in[i];
+				if (++pos == len)
+					pos = 0;
+			}
+		}
+	}
+	bt->audio_delay_pos =
+		(bt->audio_delay_pos + AUDIO_OUTPUT_FRAMES) % len;
+}
+
+static bool browser_transition_mix_audio(void *data, uint64_t *ts_out,
+					 struct obs_source_audio_mix *audio,
+					 uint32_t mixers, size_t channels,
+					 size_t sample_rate)
 {
 	struct browser_transition *browser_transition = data;
 	if (!browser_transition)
@@ -514,10 +1175,13 @@ static bool browser_transition_audio_render(void *data, uint64_t *ts_out,
 			return false;
 	}
 
+	/* the fade callbacks run for every sample, they use this copy */
+	get_schedule(browser_transition, &browser_transition->audio_schedule);
+	const struct audio_fade *fade =
+		&audio_fades[os_atomic_load_long(&browser_transition->audio_fade)];
 	const bool success = obs_transition_audio_render(
 		browser_transition->source, ts_out, audio, mixers, channels,
-		sample_rate, browser_transition->mix_a,
-		browser_transition->mix_b);
+		sample_rate, fade->mix_a, fade->mix_b);
 	if (!ts)
 		return success;
 
@@ -526,6 +1190,12 @@ static bool browser_transition_audio_render(void *data, uint64_t *ts_out,
 
 	struct obs_source_audio_mix child_audio;
 	obs_source_get_audio_mix(browser_transition->browser, &child_audio);
+	if (prepare_audio_delay(browser_transition)) {
+		mix_delayed_audio(browser_transition, audio, &child_audio,
+				  mixers, channels);
+		return true;
+	}
+
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		if ((mixers & (1 << mix)) == 0)
 			continue;
@@ -543,6 +1213,22 @@ static bool browser_transition_audio_render(void *data, uint64_t *ts_out,
 	return true;
 }
 
+static bool browser_transition_audio_render(void *data, uint64_t *ts_out,
+					    struct obs_source_audio_mix *audio,
+					    uint32_t mixers, size_t channels,
+					    size_t sample_rate)
+{
+	struct browser_transition *browser_transition = data;
+	if (!browser_transition)
+		return false;
+
+	const uint64_t trace_time = trace_begin(browser_transition);
+	const bool success = browser_transition_mix_audio(
+		data, ts_out, audio, mixers, channels, sample_rate);
+	trace_end(browser_transition, "audio_render", trace_time);
+	return success;
+}
+
 bool browser_reroute_audio_changed(void *data, obs_properties_t *props,
 				   obs_property_t *property,
 				   obs_data_t *settings)
@@ -600,6 +1286,34 @@ static bool track_matte_enabled_modified(obs_properties_t *ppts,
 	return true;
 }
 
+static bool track_matte_source_type_modified(obs_properties_t *ppts,
+					     obs_property_t *p, obs_data_t *s)
+{
+	const long long type = obs_data_get_int(s, "track_matte_source_type");
+	obs_property_set_visible(obs_properties_get(ppts, "track_matte_file"),
+				 type == MATTE_SOURCE_FILE);
+	obs_property_set_visible(obs_properties_get(ppts, "track_matte_source"),
+				 type == MATTE_SOURCE_SOURCE);
+	obs_property_set_visible(obs_properties_get(ppts, "track_matte_url"),
+				 type == MATTE_SOURCE_PAGE);
+	obs_property_set_visible(obs_properties_get(ppts, "track_matte_scale"),
+				 type == MATTE_SOURCE_PAGE);
+	obs_property_set_visible(obs_properties_get(ppts, "track_matte_fps"),
+				 type == MATTE_SOURCE_PAGE);
+	UNUSED_PARAMETER(p);
+	return true;
+}
+
+static bool add_matte_source_to_list(void *data, obs_source_t *source)
+{
+	obs_property_t *p = data;
+	if ((obs_source_get_output_flags(source) & OBS_SOURCE_VIDEO) == 0)
+		return true;
+	const char *name = obs_source_get_name(source);
+	obs_property_list_add_string(p, name, name);
+	return true;
+}
+
 static bool refresh_browser_source(obs_properties_t *props,
 				   obs_property_t *property, void *data)
 {
@@ -629,6 +1343,13 @@ obs_properties_t *browser_transition_properties(void *data)
 		100.0);
 	obs_property_float_set_suffix(p, " ms");
 
+	obs_properties_add_int_slider(props, "jitter_buffer",
+				      obs_module_text("JitterBuffer"), 0, 10,
+				      1);
+
+	obs_properties_add_bool(props, "adaptive_quality",
+				obs_module_text("AdaptiveQuality"));
+
 	obs_properties_t *track_matte_group = obs_properties_create();
 
 	p = obs_properties_add_list(track_matte_group, "track_matte_layout",
@@ -647,6 +1368,44 @@ obs_properties_t *browser_transition_properties(void *data)
 	obs_properties_add_bool(track_matte_group, "invert_matte",
 				obs_module_text("InvertTrackMatte"));
 
+	p = obs_properties_add_list(track_matte_group,
+				    "track_matte_source_type",
+				    obs_module_text("TrackMatteSource"),
+				    OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, obs_module_text("TrackMatteSourceBrowser"),
+				  MATTE_SOURCE_BROWSER);
+	obs_property_list_add_int(p, obs_module_text("TrackMatteSourceFile"),
+				  MATTE_SOURCE_FILE);
+	obs_property_list_add_int(p, obs_module_text("TrackMatteSourceSource"),
+				  MATTE_SOURCE_SOURCE);
+	obs_property_list_add_int(p, obs_module_text("TrackMatteSourcePage"),
+				  MATTE_SOURCE_PAGE);
+	obs_property_set_modified_callback(p, track_matte_source_type_modified);
+
+	obs_properties_add_path(
+		track_matte_group, "track_matte_file",
+		obs_module_text("TrackMatteFile"), OBS_PATH_FILE,
+		"Media Files (*.mp4 *.mov *.mkv *.webm *.avi *.gif *.png *.jpg);;All Files (*.*)",
+		NULL);
+
+	p = obs_properties_add_list(track_matte_group, "track_matte_source",
+				    obs_module_text("TrackMatteSourceSource"),
+				    OBS_COMBO_TYPE_LIST,
+				    OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p, "", "");
+	obs_enum_sources(add_matte_source_to_list, p);
+
+	obs_properties_add_text(track_matte_group, "track_matte_url",
+				obs_module_text("TrackMatteUrl"),
+				OBS_TEXT_DEFAULT);
+	p = obs_properties_add_int_slider(track_matte_group,
+					  "track_matte_scale",
+					  obs_module_text("TrackMatteScale"),
+					  10, 100, 5);
+	obs_property_int_set_suffix(p, "%");
+	obs_properties_add_int(track_matte_group, "track_matte_fps",
+			       obs_module_text("TrackMatteFps"), 1, 60, 1);
+
 	p = obs_properties_add_group(props, "track_matte_enabled",
 				     obs_module_text("TrackMatteEnabled"),
 				     OBS_GROUP_CHECKABLE, track_matte_group);
@@ -676,9 +1435,13 @@ obs_properties_t *browser_transition_properties(void *data)
 		props, "audio_fade_style", obs_module_text("AudioFadeStyle"),
 		OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_property_list_add_int(audio_fade_style,
-				  obs_module_text("FadeOutFadeIn"), 0);
+				  obs_module_text("FadeOutFadeIn"),
+				  AUDIO_FADE_IN_OUT);
+	obs_property_list_add_int(audio_fade_style,
+				  obs_module_text("CrossFade"), AUDIO_FADE_CROSS);
 	obs_property_list_add_int(audio_fade_style,
-				  obs_module_text("CrossFade"), 1);
+				  obs_module_text("FadeTrackMatte"),
+				  AUDIO_FADE_MATTE);
 
 	obs_properties_t *bp =
 		obs_source_properties(browser_transition->browser);
@@ -714,6 +1477,14 @@ obs_properties_t *browser_transition_properties(void *data)
 		obs_property_set_modified_callback2(
 			p, browser_reroute_audio_changed, data);
 	}
+	obs_properties_t *trace_group = obs_properties_create();
+	obs_properties_add_path(trace_group, "trace_file",
+				obs_module_text("TraceFile"), OBS_PATH_FILE_SAVE,
+				"Trace (*.json)", NULL);
+	obs_properties_add_group(props, "trace_enabled",
+				 obs_module_text("TraceEnabled"),
+				 OBS_GROUP_CHECKABLE, trace_group);
+
 	obs_properties_add_text(
 		props, "plugin_info",
 		"<a href=\"https://obsproject.com/forum/resources/browser-transition.1653/\">Browser Transition</a> (" PROJECT_VERSION
@@ -728,6 +1499,8 @@ void browser_transition_defaults(obs_data_t *settings)
 	obs_data_set_default_double(settings, "transition_point", 50.0);
 	obs_data_set_default_double(settings, "transition_point_ms", 250.0);
 	obs_data_set_default_double(settings, "audio_volume", 100.0);
+	obs_data_set_default_int(settings, "track_matte_scale", 50);
+	obs_data_set_default_int(settings, "track_matte_fps", 30);
 	obs_data_t *d = obs_get_source_defaults("browser_source");
 	obs_data_item_t *i = obs_data_first(d);
 	while (i) {
@@ -770,9 +1543,43 @@ void browser_transition_defaults(obs_data_t *settings)
 	obs_data_release(d);
 }
 
-void browser_transition_start(void *data)
+static void resize_matte_browser(struct browser_transition *bt, uint32_t cx,
+				 uint32_t cy)
 {
-	struct browser_transition *browser_transition = data;
+	obs_data_t *s = obs_source_get_settings(bt->matte_browser);
+	if (!s)
+		return;
+	cx = (uint32_t)((float)cx * bt->matte_browser_scale);
+	cy = (uint32_t)((float)cy * bt->matte_browser_scale);
+	if (cx && cy &&
+	    (cx != (uint32_t)obs_data_get_int(s, "width") ||
+	     cy != (uint32_t)obs_data_get_int(s, "height"))) {
+		obs_data_set_int(s, "width", cx);
+		obs_data_set_int(s, "height", cy);
+		obs_source_update(bt->matte_browser, NULL);
+		if (is_tracing(bt))
+			trace_instant(bt->trace_pid, "matte_browser_resize",
+				      "start");
+	}
+	obs_data_release(s);
+}
+
+static void browser_transition_cold_start(
+	struct browser_transition *browser_transition)
+{
+	struct obs_video_info ovi = {0};
+	struct obs_audio_info oai = {0};
+	obs_get_video_info(&ovi);
+	obs_get_audio_info(&oai);
+	const double delay_ms = jitter_delay_ms(browser_transition);
+	struct transition_schedule schedule;
+	transition_schedule_init(&schedule, browser_transition->duration,
+				 browser_transition->transition_point,
+				 ovi.fps_num, ovi.fps_den, oai.samples_per_sec);
+	transition_schedule_set_delay(&schedule, delay_ms);
+	pthread_mutex_lock(&browser_transition->schedule_mutex);
+	browser_transition->schedule = schedule;
+	pthread_mutex_unlock(&browser_transition->schedule_mutex);
 
 	uint32_t cx = obs_source_get_width(browser_transition->source);
 	uint32_t cy = obs_source_get_height(browser_transition->source);
@@ -810,6 +1617,14 @@ void browser_transition_start(void *data)
 	obs_data_t *s = obs_source_get_settings(browser_transition->browser);
 	if (!s)
 		return;
+	browser_transition->canvas_cx = cx;
+	browser_transition->canvas_cy = cy;
+	const enum quality_level quality = get_quality(browser_transition);
+	if (quality >= QUALITY_HALF_BROWSER) {
+		/* the render paths scale the browser up to the canvas */
+		cx = cx > 1 ? cx / 2 : cx;
+		cy = cy > 1 ? cy / 2 : cy;
+	}
 	if (browser_transition->track_matte_enabled) {
 		cx *= (uint32_t)browser_transition->matte_width_factor;
 		cy *= (uint32_t)browser_transition->matte_height_factor;
@@ -821,23 +1636,33 @@ void browser_transition_start(void *data)
 		obs_data_set_int(s, "width", cx);
 		obs_data_set_int(s, "height", cy);
 		obs_source_update(browser_transition->browser, NULL);
+		if (is_tracing(browser_transition))
+			trace_instant(browser_transition->trace_pid,
+				      "browser_resize", "start");
 	}
 	obs_data_release(s);
 
-	browser_transition->matte_rendered = false;
+	if (browser_transition->track_matte_enabled &&
+	    browser_transition->matte_source_type == MATTE_SOURCE_PAGE)
+		resize_matte_browser(browser_transition,
+				     browser_transition->canvas_cx,
+				     browser_transition->canvas_cy);
 
-	obs_transition_enable_fixed(browser_transition->source, true,
-				    (uint32_t)browser_transition->duration);
+	obs_transition_enable_fixed(
+		browser_transition->source, true,
+		(uint32_t)((double)browser_transition->duration + delay_ms));
+	os_atomic_set_bool(&browser_transition->audio_delay_reset, true);
+
+	obs_enter_graphics();
+	browser_transition->start_quality = quality;
+	browser_transition->matte_rendered = false;
+	matte_coverage_reset(browser_transition->coverage);
+	frame_ring_set_interval(browser_transition->jitter,
+				browser_frame_interval(browser_transition));
+	frame_ring_reset(browser_transition->jitter);
+	add_active_children(browser_transition);
+	obs_leave_graphics();
 
-	if (!browser_transition->transitioning) {
-		browser_transition->transitioning = true;
-		obs_source_add_active_child(browser_transition->source,
-					    browser_transition->browser);
-	}
-	proc_handler_t *ph =
-		obs_source_get_proc_handler(browser_transition->browser);
-	if (!ph)
-		return;
 	obs_data_t *json = obs_data_create();
 	obs_data_set_string(json, "transition",
 			    obs_source_get_name(browser_transition->source));
@@ -846,40 +1671,102 @@ void browser_transition_start(void *data)
 	obs_data_set_double(json, "duration", browser_transition->duration);
 	obs_data_set_double(json, "transitionPoint",
 			    browser_transition->transition_point);
-	struct calldata cd = {0};
-	calldata_set_string(&cd, "eventName", "transitionStart");
-	calldata_set_string(&cd, "jsonString", obs_data_get_json(json));
-	proc_handler_call(ph, "javascript_event", &cd);
-	calldata_free(&cd);
+	const struct transition_schedule *ts = &schedule;
+	if (ts->valid) {
+		obs_data_set_int(json, "transitionFrame",
+				 (long long)ts->cut_frame);
+		obs_data_set_int(json, "transitionSample",
+				 (long long)ts->cut_sample);
+		obs_data_set_double(json, "transitionTime",
+				    transition_schedule_cut_ms(ts));
+	}
+	send_javascript_event(browser_transition, "transitionStart",
+			      obs_data_get_json(json));
 	obs_data_release(json);
 }
 
-void browser_transition_stop(void *data)
+static bool can_restart(struct browser_transition *bt)
+{
+	if (!bt->transitioning || !bt->canvas_cx || !bt->canvas_cy)
+		return false;
+
+	/* only fall back to a full start when the canvas size or the
+	 * quality level changed */
+	const uint32_t cx = obs_source_get_width(bt->source);
+	const uint32_t cy = obs_source_get_height(bt->source);
+	if (cx && cy && (cx != bt->canvas_cx || cy != bt->canvas_cy))
+		return false;
+	return get_quality(bt) == bt->start_quality;
+}
+
+static bool browser_transition_restart(struct browser_transition *bt)
+{
+	/* render drops the active children once the transition has run out,
+	 * so the check and the matte restart must not interleave with it */
+	obs_enter_graphics();
+	const bool restart = can_restart(bt);
+	if (restart) {
+		bt->matte_rendered = false;
+		matte_coverage_reset(bt->coverage);
+		frame_ring_reset(bt->jitter);
+		if (bt->active_matte)
+			restart_matte(bt, bt->active_matte);
+	}
+	obs_leave_graphics();
+
+	if (restart)
+		send_javascript_event(bt, "transitionRestart", NULL);
+	return restart;
+}
+
+void browser_transition_start(void *data)
 {
 	struct browser_transition *browser_transition = data;
-	if (!browser_transition->browser)
+	const uint64_t trace_time = trace_begin(browser_transition);
+	const uint64_t start_time = os_gettime_ns();
+
+	if (browser_transition_restart(browser_transition)) {
+		render_timing_add_cpu(browser_transition->timing,
+				      RENDER_CPU_RESTART,
+				      os_gettime_ns() - start_time);
+		trace_end(browser_transition, "restart", trace_time);
 		return;
-	if (browser_transition->transitioning) {
-		browser_transition->transitioning = false;
-		obs_source_remove_active_child(browser_transition->source,
-					       browser_transition->browser);
 	}
-	proc_handler_t *ph =
-		obs_source_get_proc_handler(browser_transition->browser);
-	if (!ph)
+
+	browser_transition_cold_start(browser_transition);
+	render_timing_add_cpu(browser_transition->timing, RENDER_CPU_START,
+			      os_gettime_ns() - start_time);
+	trace_end(browser_transition, "start", trace_time);
+}
+
+void browser_transition_stop(void *data)
+{
+	struct browser_transition *browser_transition = data;
+	if (!browser_transition->browser)
 		return;
-	struct calldata cd = {0};
-	calldata_set_string(&cd, "eventName", "transitionStop");
-	proc_handler_call(ph, "javascript_event", &cd);
-	calldata_free(&cd);
+	const uint64_t trace_time = trace_begin(browser_transition);
+	obs_enter_graphics();
+	remove_active_children(browser_transition);
+	obs_leave_graphics();
+	render_timing_log(browser_transition->timing,
+			  obs_source_get_name(browser_transition->source));
+	obs_enter_graphics();
+	frame_ring_log(browser_transition->jitter,
+		       obs_source_get_name(browser_transition->source));
+	obs_leave_graphics();
+	send_javascript_event(browser_transition, "transitionStop", NULL);
+	update_browser_fps(browser_transition);
+	trace_end(browser_transition, "stop", trace_time);
 }
 
 static void browser_transition_enum_active_sources(
 	void *data, obs_source_enum_proc_t enum_callback, void *param)
 {
 	struct browser_transition *s = data;
-	if (s->browser && s->transitioning)
+	if (s->browser && s->browser_active)
 		enum_callback(s->source, s->browser, param);
+	if (s->active_matte)
+		enum_callback(s->source, s->active_matte, param);
 }
 
 static void browser_transition_enum_all_sources(
@@ -888,18 +1775,36 @@ static void browser_transition_enum_all_sources(
 	struct browser_transition *s = data;
 	if (s->browser)
 		enum_callback(s->source, s->browser, param);
+	if (s->matte_file_source)
+		enum_callback(s->source, s->matte_file_source, param);
+	if (s->matte_browser)
+		enum_callback(s->source, s->matte_browser, param);
 }
 
 static void browser_transition_tick(void *data, float seconds)
 {
 	struct browser_transition *s = data;
+	const uint64_t trace_time = trace_begin(s);
 
+	/* update swaps the texrenders and the jitter buffer */
+	obs_enter_graphics();
 	if (s->track_matte_enabled) {
 		gs_texrender_reset(s->stinger_tex);
 		gs_texrender_reset(s->matte_tex);
 	}
+	frame_ring_tick(s->jitter);
+	const bool transitioning = s->transitioning;
+	const enum quality_level rendered = get_rendered_quality(s);
+	obs_leave_graphics();
 
-	UNUSED_PARAMETER(seconds);
+	float pass_ms;
+	const uint32_t frames = render_timing_take_frames(s->timing, &pass_ms);
+	if (os_atomic_load_bool(&s->adaptive))
+		adaptive_quality_tick(&s->quality, seconds, transitioning,
+				      rendered, pass_ms, frames,
+				      obs_source_get_name(s->source));
+
+	trace_end(s, "tick", trace_time);
 }
 
 static enum gs_color_space
@@ -962,6 +1867,11 @@ MODULE_EXPORT const char *obs_module_name(void)
 	return obs_module_text("BrowserTransition");
 }
 
+void obs_module_unload(void)
+{
+	trace_free();
+}
+
 bool obs_module_load(void)
 {
 	blog(LOG_INFO, "[Browser Transition] loaded version %s",
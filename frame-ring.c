@@ -0,0 +1,345 @@
+#include "frame-ring.h"
+#include <util/threading.h>
+
+/* captures are scaled down to this size and read back to spot the frames
+ * the browser didn't repaint */
+#define FRAME_HASH_SIZE 64
+/* hashes are read this many frames after they were staged */
+#define FRAME_HASH_STAGES 3
+
+struct frame_slot {
+	gs_texrender_t *texrender;
+	uint64_t sequence;
+	/* a repeated paint, set once its readback is in */
+	bool stall;
+	bool shown;
+};
+
+struct frame_stage {
+	gs_stagesurf_t *surf;
+	size_t slot;
+	uint64_t sequence;
+	bool staged;
+};
+
+struct frame_ring {
+	size_t depth;
+	size_t capacity;
+	struct frame_slot *slots;
+	uint64_t sequence;
+
+	gs_texrender_t *thumb;
+	struct frame_stage stages[FRAME_HASH_STAGES];
+	size_t stage_write;
+	uint32_t last_hash;
+	bool has_hash;
+	uint32_t run;
+	uint32_t interval;
+
+	size_t write;
+	size_t count;
+	size_t display;
+	bool has_display;
+	bool priming;
+
+	volatile bool new_frame;
+	volatile bool reset;
+
+	volatile long captured;
+	volatile long repeated;
+	volatile long skipped;
+	volatile long underruns;
+	volatile long dropped;
+};
+
+struct frame_ring *frame_ring_create(size_t depth)
+{
+	struct frame_ring *ring = bzalloc(sizeof(struct frame_ring));
+	ring->depth = depth;
+	/* one slot more than buffered is always kept for the displayed frame */
+	ring->capacity = depth + 2;
+	ring->slots = bzalloc(sizeof(struct frame_slot) * ring->capacity);
+	for (size_t i = 0; i < ring->capacity; i++)
+		ring->slots[i].texrender =
+			gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	ring->thumb = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	ring->interval = 1;
+	ring->priming = true;
+	return ring;
+}
+
+void frame_ring_destroy(struct frame_ring *ring)
+{
+	if (!ring)
+		return;
+	for (size_t i = 0; i < ring->capacity; i++)
+		gs_texrender_destroy(ring->slots[i].texrender);
+	gs_texrender_destroy(ring->thumb);
+	for (size_t i = 0; i < FRAME_HASH_STAGES; i++)
+		gs_stagesurface_destroy(ring->stages[i].surf);
+	bfree(ring->slots);
+	bfree(ring);
+}
+
+void frame_ring_set_interval(struct frame_ring *ring, uint32_t frames)
+{
+	if (ring)
+		ring->interval = frames ? frames : 1;
+}
+
+void frame_ring_reset(struct frame_ring *ring)
+{
+	if (ring)
+		os_atomic_set_bool(&ring->reset, true);
+}
+
+void frame_ring_tick(struct frame_ring *ring)
+{
+	if (ring)
+		os_atomic_set_bool(&ring->new_frame, true);
+}
+
+static void stage_hash(struct frame_ring *ring, size_t slot)
+{
+	gs_texture_t *tex =
+		gs_texrender_get_texture(ring->slots[slot].texrender);
+	gs_texrender_reset(ring->thumb);
+	if (!tex || !gs_texrender_begin(ring->thumb, FRAME_HASH_SIZE,
+					FRAME_HASH_SIZE))
+		return;
+
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_ortho(0.0f, (float)FRAME_HASH_SIZE, 0.0f, (float)FRAME_HASH_SIZE,
+		 -100.0f, 100.0f);
+	gs_blend_state_push();
+	gs_enable_blending(false);
+	gs_effect_set_texture(image, tex);
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, FRAME_HASH_SIZE, FRAME_HASH_SIZE);
+	gs_blend_state_pop();
+	gs_texrender_end(ring->thumb);
+
+	struct frame_stage *stage = &ring->stages[ring->stage_write];
+	if (!stage->surf)
+		stage->surf = gs_stagesurface_create(FRAME_HASH_SIZE,
+						     FRAME_HASH_SIZE, GS_RGBA);
+	if (!stage->surf)
+		return;
+	gs_stage_texture(stage->surf, gs_texrender_get_texture(ring->thumb));
+	stage->slot = slot;
+	stage->sequence = ring->slots[slot].sequence;
+	stage->staged = true;
+	ring->stage_write = (ring->stage_write + 1) % FRAME_HASH_STAGES;
+}
+
+static uint32_t hash_pixels(const uint8_t *data, uint32_t linesize)
+{
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	for (uint32_t y = 0; y < FRAME_HASH_SIZE; y++) {
+		const uint8_t *row = data + (size_t)y * linesize;
+		for (uint32_t x = 0; x < FRAME_HASH_SIZE * 4; x++) {
+			hash ^= row[x];
+			hash *= 16777619u;
+		}
+	}
+	return hash;
+}
+
+/* the browser paints every interval frames, a capture that shows the same
+ * picture for longer than that is a stall */
+static void read_hash(struct frame_ring *ring)
+{
+	/* the stage after the one just written is the oldest */
+	struct frame_stage *stage = &ring->stages[ring->stage_write];
+	if (!stage->staged)
+		return;
+	stage->staged = false;
+
+	uint8_t *data;
+	uint32_t linesize;
+	if (!gs_stagesurface_map(stage->surf, &data, &linesize))
+		return;
+	const uint32_t hash = hash_pixels(data, linesize);
+	gs_stagesurface_unmap(stage->surf);
+
+	if (ring->has_hash && hash == ring->last_hash)
+		ring->run++;
+	else
+		ring->run = 0;
+	ring->last_hash = hash;
+	ring->has_hash = true;
+	if (ring->run < ring->interval)
+		return;
+
+	os_atomic_inc_long(&ring->repeated);
+	/* one shown before its readback was in held the picture */
+	struct frame_slot *slot = &ring->slots[stage->slot];
+	if (slot->sequence != stage->sequence)
+		return;
+	if (slot->shown)
+		os_atomic_inc_long(&ring->underruns);
+	else
+		slot->stall = true;
+}
+
+static void capture(struct frame_ring *ring, obs_source_t *source,
+		    uint32_t cx, uint32_t cy)
+{
+	const enum gs_color_space space =
+		obs_source_get_color_space(source, 0, NULL);
+	const enum gs_color_format format = gs_get_format_from_space(space);
+	struct frame_slot *slot = &ring->slots[ring->write];
+	if (gs_texrender_get_format(slot->texrender) != format) {
+		gs_texrender_destroy(slot->texrender);
+		slot->texrender = gs_texrender_create(format, GS_ZS_NONE);
+	}
+
+	gs_texrender_reset(slot->texrender);
+	if (gs_texrender_begin_with_color_space(slot->texrender, cx, cy,
+						space)) {
+		struct vec4 clear_color;
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		gs_blend_state_push();
+		gs_enable_blending(false);
+		const bool previous = gs_set_linear_srgb(true);
+		obs_source_video_render(source);
+		gs_set_linear_srgb(previous);
+		gs_blend_state_pop();
+
+		gs_texrender_end(slot->texrender);
+	}
+	slot->sequence = ++ring->sequence;
+	slot->stall = false;
+	slot->shown = false;
+	stage_hash(ring, ring->write);
+
+	ring->write = (ring->write + 1) % ring->capacity;
+	ring->count++;
+	os_atomic_inc_long(&ring->captured);
+}
+
+void frame_ring_update(struct frame_ring *ring, obs_source_t *source)
+{
+	if (!ring)
+		return;
+
+	if (os_atomic_load_bool(&ring->reset)) {
+		os_atomic_set_bool(&ring->reset, false);
+		ring->write = 0;
+		ring->count = 0;
+		ring->has_display = false;
+		ring->priming = true;
+		ring->has_hash = false;
+		ring->run = 0;
+		for (size_t i = 0; i < FRAME_HASH_STAGES; i++)
+			ring->stages[i].staged = false;
+	}
+
+	if (!os_atomic_load_bool(&ring->new_frame))
+		return;
+	os_atomic_set_bool(&ring->new_frame, false);
+
+	const uint32_t cx = obs_source_get_width(source);
+	const uint32_t cy = obs_source_get_height(source);
+	if (obs_source_active(source) && cx && cy) {
+		if (ring->count == ring->capacity - 1) {
+			ring->count--;
+			os_atomic_inc_long(&ring->dropped);
+		}
+		capture(ring, source, cx, cy);
+	}
+	read_hash(ring);
+
+	/* the frame captured depth frames ago is shown once the frame after
+	 * it is in as well */
+	if (ring->priming) {
+		if (ring->count <= ring->depth)
+			return;
+		ring->priming = false;
+	}
+
+	/* the buffered frames make up for the paints the browser stalled
+	 * on, a frame held while the ring is empty refills it */
+	size_t oldest = (ring->write + ring->capacity - ring->count) %
+			ring->capacity;
+	while (ring->count && ring->slots[oldest].stall) {
+		ring->count--;
+		oldest = (oldest + 1) % ring->capacity;
+		os_atomic_inc_long(&ring->skipped);
+	}
+	if (!ring->count) {
+		if (ring->has_display)
+			os_atomic_inc_long(&ring->underruns);
+		return;
+	}
+
+	ring->display = oldest;
+	ring->slots[oldest].shown = true;
+	ring->count--;
+	ring->has_display = true;
+}
+
+gs_texture_t *frame_ring_get(struct frame_ring *ring)
+{
+	if (!ring || !ring->has_display)
+		return NULL;
+	return gs_texrender_get_texture(ring->slots[ring->display].texrender);
+}
+
+uint64_t frame_ring_get_size(struct frame_ring *ring)
+{
+	if (!ring)
+		return 0;
+	uint64_t size = 0;
+	for (size_t i = 0; i <= ring->capacity; i++) {
+		gs_texture_t *tex = gs_texrender_get_texture(
+			i < ring->capacity ? ring->slots[i].texrender
+					   : ring->thumb);
+		if (tex)
+			size += (uint64_t)gs_texture_get_width(tex) *
+				gs_texture_get_height(tex) *
+				gs_get_format_bpp(
+					gs_texture_get_color_format(tex)) /
+				8;
+	}
+	for (size_t i = 0; i < FRAME_HASH_STAGES; i++)
+		if (ring->stages[i].surf)
+			size += FRAME_HASH_SIZE * FRAME_HASH_SIZE * 4;
+	return size;
+}
+
+void frame_ring_get_stats(struct frame_ring *ring, obs_data_t *data)
+{
+	if (!ring)
+		return;
+	obs_data_t *stats = obs_data_create();
+	obs_data_set_int(stats, "depth", (long long)ring->depth);
+	obs_data_set_int(stats, "captured",
+			 os_atomic_load_long(&ring->captured));
+	obs_data_set_int(stats, "underruns",
+			 os_atomic_load_long(&ring->underruns));
+	obs_data_set_int(stats, "repeated",
+			 os_atomic_load_long(&ring->repeated));
+	obs_data_set_int(stats, "skipped", os_atomic_load_long(&ring->skipped));
+	obs_data_set_int(stats, "dropped", os_atomic_load_long(&ring->dropped));
+	obs_data_set_obj(data, "jitterBuffer", stats);
+	obs_data_release(stats);
+}
+
+void frame_ring_log(struct frame_ring *ring, const char *name)
+{
+	if (!ring || !os_atomic_load_long(&ring->captured))
+		return;
+	blog(LOG_INFO,
+	     "[Browser Transition] '%s' jitter buffer (%zu frames): %ld captured, %ld repeated, %ld skipped, %ld underruns, %ld dropped",
+	     name, ring->depth, os_atomic_load_long(&ring->captured),
+	     os_atomic_load_long(&ring->repeated),
+	     os_atomic_load_long(&ring->skipped),
+	     os_atomic_load_long(&ring->underruns),
+	     os_atomic_load_long(&ring->dropped));
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "obs-module.h"
+
+/*
+ * Small GPU ring of captured browser frames, shown depth frames behind
+ * capture. libobs doesn't tell when the browser painted, so every capture
+ * is scaled down and read back a couple of frames later: a picture that
+ * stays the same for longer than the browser frame interval is a stall,
+ * and those frames are skipped instead of shown, the buffered ones make
+ * up for them. The caller delays the cut and the browser audio by depth
+ * frames, skipped frames bring the stinger up to that much earlier.
+ *
+ * The readback needs two frames, a depth below that only counts stalls.
+ * Changes too small for the scaled down capture look like stalls too.
+ */
+struct frame_ring;
+
+/* create, destroy, update and get need the graphics context */
+struct frame_ring *frame_ring_create(size_t depth);
+void frame_ring_destroy(struct frame_ring *ring);
+/* the browser paints once every frames frames, 1 unless set */
+void frame_ring_set_interval(struct frame_ring *ring, uint32_t frames);
+
+/* captures the source once per frame and advances the display position */
+void frame_ring_update(struct frame_ring *ring, obs_source_t *source);
+gs_texture_t *frame_ring_get(struct frame_ring *ring);
+/* bytes of video memory held by the captured frames and their readback */
+uint64_t frame_ring_get_size(struct frame_ring *ring);
+
+/* safe from any thread */
+void frame_ring_reset(struct frame_ring *ring);
+void frame_ring_tick(struct frame_ring *ring);
+void frame_ring_get_stats(struct frame_ring *ring, obs_data_t *data);
+void frame_ring_log(struct frame_ring *ring, const char *name);
@@ -0,0 +1,569 @@
+#include "matte-composite.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_SSE2
+#include <emmintrin.h>
+
+/* the avx2 path is compiled for the target alone and picked at runtime */
+#if defined(_MSC_VER)
+#define HAVE_AVX2
+#define AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__) || defined(__clang__)
+#define HAVE_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+/* Rec. 709 luma factors, same as matte_transition.effect */
+#define LUMA_R 0.2126f
+#define LUMA_G 0.7152f
+#define LUMA_B 0.0722f
+
+#define RGBA8_CHUNK 64
+
+float matte_srgb_nonlinear_to_linear(float u)
+{
+	return (u <= 0.04045f) ? (u / 12.92f)
+			       : powf((u + 0.055f) / 1.055f, 2.4f);
+}
+
+float matte_srgb_linear_to_nonlinear(float u)
+{
+	return (u <= 0.0031308f) ? (u * 12.92f)
+				 : (1.055f * powf(u, 1.0f / 2.4f) - 0.055f);
+}
+
+/* ------------------------------------------------------------------------- */
+/* scalar, always built so it can serve as reference for the simd paths     */
+
+static void composite_f32_c(float *out, const float *a, const float *b,
+			    const float *matte, size_t pixels, bool invert,
+			    bool linear, bool encode)
+{
+	for (size_t i = 0; i < pixels; i++) {
+		const size_t o = i * 4;
+		float luma = matte[o] * LUMA_R + matte[o + 1] * LUMA_G +
+			     matte[o + 2] * LUMA_B;
+		if (invert)
+			luma = 1.0f - luma;
+
+		for (size_t c = 0; c < 4; c++)
+			out[o + c] = a[o + c] + (b[o + c] - a[o + c]) * luma;
+		for (size_t c = 0; c < 3; c++) {
+			if (!linear)
+				out[o + c] =
+					matte_srgb_nonlinear_to_linear(out[o + c]);
+			if (encode)
+				out[o + c] =
+					matte_srgb_linear_to_nonlinear(out[o + c]);
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* sse2, four pixels at a time with the channels transposed into lanes       */
+
+#ifdef HAVE_SSE2
+static inline __m128 select_sse2(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/* log2 and exp2 polynomials from Cephes, a few ulp from powf */
+static inline __m128 log2_sse2(__m128 x)
+{
+	const __m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(
+		_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+			     _mm_set1_epi32(0x3f800000)));
+
+	/* keep the mantissa in [sqrt(0.5), sqrt(2)) */
+	const __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+	m = select_sse2(big, _mm_mul_ps(m, _mm_set1_ps(0.5f)), m);
+	e = _mm_sub_epi32(e, _mm_castps_si128(big));
+
+	const __m128 f = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+	const __m128 z = _mm_mul_ps(f, f);
+	__m128 y = _mm_set1_ps(7.0376836292e-2f);
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(-1.1514610310e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(1.1676998740e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(-1.2420140846e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(1.4249322787e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(-1.6668057665e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(2.0000714765e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(-2.4999993993e-1f));
+	y = _mm_add_ps(_mm_mul_ps(y, f), _mm_set1_ps(3.3333331174e-1f));
+	y = _mm_mul_ps(_mm_mul_ps(y, f), z);
+	y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+	const __m128 ln = _mm_add_ps(f, y);
+
+	return _mm_add_ps(_mm_mul_ps(ln, _mm_set1_ps(1.44269504f)),
+			  _mm_cvtepi32_ps(e));
+}
+
+static inline __m128 exp2_sse2(__m128 x)
+{
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)),
+		       _mm_set1_ps(126.0f));
+	const __m128i n = _mm_cvtps_epi32(x);
+	const __m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+
+	__m128 p = _mm_set1_ps(1.535336188319500e-4f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.339887440266574e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.618437357674640e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.550332471162809e-2f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.402264791363012e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.931472028550421e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+	const __m128i scale =
+		_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+}
+
+static inline __m128 pow_sse2(__m128 x, float y)
+{
+	x = _mm_max_ps(x, _mm_set1_ps(1.17549435e-38f));
+	return exp2_sse2(_mm_mul_ps(log2_sse2(x), _mm_set1_ps(y)));
+}
+
+static inline __m128 to_linear_sse2(__m128 u)
+{
+	const __m128 low = _mm_div_ps(u, _mm_set1_ps(12.92f));
+	const __m128 x = _mm_div_ps(_mm_add_ps(u, _mm_set1_ps(0.055f)),
+				    _mm_set1_ps(1.055f));
+	return select_sse2(_mm_cmple_ps(u, _mm_set1_ps(0.04045f)), low,
+			   pow_sse2(x, 2.4f));
+}
+
+static inline __m128 to_nonlinear_sse2(__m128 u)
+{
+	const __m128 low = _mm_mul_ps(u, _mm_set1_ps(12.92f));
+	const __m128 high =
+		_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(1.055f),
+				      pow_sse2(u, 1.0f / 2.4f)),
+			   _mm_set1_ps(0.055f));
+	return select_sse2(_mm_cmple_ps(u, _mm_set1_ps(0.0031308f)), low,
+			   high);
+}
+
+static inline void composite4_sse2(float *out, const float *a, const float *b,
+				   const float *matte, bool invert,
+				   bool linear, bool encode)
+{
+	__m128 ar = _mm_loadu_ps(a), ag = _mm_loadu_ps(a + 4),
+	       ab = _mm_loadu_ps(a + 8), aa = _mm_loadu_ps(a + 12);
+	__m128 br = _mm_loadu_ps(b), bg = _mm_loadu_ps(b + 4),
+	       bb = _mm_loadu_ps(b + 8), ba = _mm_loadu_ps(b + 12);
+	__m128 mr = _mm_loadu_ps(matte), mg = _mm_loadu_ps(matte + 4),
+	       mb = _mm_loadu_ps(matte + 8), ma = _mm_loadu_ps(matte + 12);
+	_MM_TRANSPOSE4_PS(ar, ag, ab, aa);
+	_MM_TRANSPOSE4_PS(br, bg, bb, ba);
+	_MM_TRANSPOSE4_PS(mr, mg, mb, ma);
+
+	/* same order of operations as the scalar path */
+	__m128 luma = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(mr, _mm_set1_ps(LUMA_R)),
+			   _mm_mul_ps(mg, _mm_set1_ps(LUMA_G))),
+		_mm_mul_ps(mb, _mm_set1_ps(LUMA_B)));
+	if (invert)
+		luma = _mm_sub_ps(_mm_set1_ps(1.0f), luma);
+
+	__m128 r = _mm_add_ps(ar, _mm_mul_ps(_mm_sub_ps(br, ar), luma));
+	__m128 g = _mm_add_ps(ag, _mm_mul_ps(_mm_sub_ps(bg, ag), luma));
+	__m128 bl = _mm_add_ps(ab, _mm_mul_ps(_mm_sub_ps(bb, ab), luma));
+	__m128 al = _mm_add_ps(aa, _mm_mul_ps(_mm_sub_ps(ba, aa), luma));
+	if (!linear) {
+		r = to_linear_sse2(r);
+		g = to_linear_sse2(g);
+		bl = to_linear_sse2(bl);
+	}
+	if (encode) {
+		r = to_nonlinear_sse2(r);
+		g = to_nonlinear_sse2(g);
+		bl = to_nonlinear_sse2(bl);
+	}
+
+	_MM_TRANSPOSE4_PS(r, g, bl, al);
+	_mm_storeu_ps(out, r);
+	_mm_storeu_ps(out + 4, g);
+	_mm_storeu_ps(out + 8, bl);
+	_mm_storeu_ps(out + 12, al);
+}
+
+static void composite_f32_sse2(float *out, const float *a, const float *b,
+			       const float *matte, size_t pixels, bool invert,
+			       bool linear, bool encode)
+{
+	size_t i = 0;
+	for (; i + 4 <= pixels; i += 4)
+		composite4_sse2(out + i * 4, a + i * 4, b + i * 4,
+				matte + i * 4, invert, linear, encode);
+
+	/* the tail goes through zero padded buffers */
+	if (i < pixels) {
+		float ta[16] = {0}, tb[16] = {0}, tm[16] = {0}, to[16];
+		const size_t size = (pixels - i) * 4 * sizeof(float);
+		memcpy(ta, a + i * 4, size);
+		memcpy(tb, b + i * 4, size);
+		memcpy(tm, matte + i * 4, size);
+		composite4_sse2(to, ta, tb, tm, invert, linear, encode);
+		memcpy(out + i * 4, to, size);
+	}
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* avx2, the sse2 path twice over, pixels 0-3 in the low lane, 4-7 high      */
+
+#ifdef HAVE_AVX2
+#define TRANSPOSE4_256(r0, r1, r2, r3)                                   \
+	do {                                                             \
+		const __m256 t0 = _mm256_shuffle_ps(r0, r1, 0x44);       \
+		const __m256 t2 = _mm256_shuffle_ps(r0, r1, 0xEE);       \
+		const __m256 t1 = _mm256_shuffle_ps(r2, r3, 0x44);       \
+		const __m256 t3 = _mm256_shuffle_ps(r2, r3, 0xEE);       \
+		r0 = _mm256_shuffle_ps(t0, t1, 0x88);                    \
+		r1 = _mm256_shuffle_ps(t0, t1, 0xDD);                    \
+		r2 = _mm256_shuffle_ps(t2, t3, 0x88);                    \
+		r3 = _mm256_shuffle_ps(t2, t3, 0xDD);                    \
+	} while (false)
+
+static AVX2_TARGET inline __m256 log2_avx2(__m256 x)
+{
+	const __m256i bits = _mm256_castps_si256(x);
+	__m256i e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23),
+				     _mm256_set1_epi32(127));
+	__m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+		_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+		_mm256_set1_epi32(0x3f800000)));
+
+	const __m256 big =
+		_mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+	m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+	e = _mm256_sub_epi32(e, _mm256_castps_si256(big));
+
+	const __m256 f = _mm256_sub_ps(m, _mm256_set1_ps(1.0f));
+	const __m256 z = _mm256_mul_ps(f, f);
+	__m256 y = _mm256_set1_ps(7.0376836292e-2f);
+	y = _mm256_add_ps(_mm256_mul_ps(y, f),
+			  _mm256_set1_ps(-1.1514610310e-1f));
+	y = _mm256_add_ps(_mm256_mul_ps(y, f),
+			  _mm256_set1_ps(1.1676998740e-1f));
+	y = _mm256_add_ps(_mm256_mul_ps(y, f),
+			  _mm256_set1_ps(-1.2420140846e-1f));
+	y = _mm256_add_ps(_mm256_mul_ps(y, f),
+			  _mm256_set1_ps(1.4249322787e-1f));
+	y = _mm256_add_ps(_mm256_mul_ps(y, f),
+			  _mm256_set1_ps(-1.6668057665e-1f));
+	y = _mm256_add_ps(_mm256_mul_ps(y, f),
+			  _mm256_set1_ps(2.0000714765e-1f));
+	y = _mm256_add_ps(_mm256_mul_ps(y, f),
+			  _mm256_set1_ps(-2.4999993993e-1f));
+	y = _mm256_add_ps(_mm256_mul_ps(y, f),
+			  _mm256_set1_ps(3.3333331174e-1f));
+	y = _mm256_mul_ps(_mm256_mul_ps(y, f), z);
+	y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+	const __m256 ln = _mm256_add_ps(f, y);
+
+	return _mm256_add_ps(_mm256_mul_ps(ln, _mm256_set1_ps(1.44269504f)),
+			     _mm256_cvtepi32_ps(e));
+}
+
+static AVX2_TARGET inline __m256 exp2_avx2(__m256 x)
+{
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.0f)),
+			  _mm256_set1_ps(126.0f));
+	const __m256i n = _mm256_cvtps_epi32(x);
+	const __m256 f = _mm256_sub_ps(x, _mm256_cvtepi32_ps(n));
+
+	__m256 p = _mm256_set1_ps(1.535336188319500e-4f);
+	p = _mm256_add_ps(_mm256_mul_ps(p, f),
+			  _mm256_set1_ps(1.339887440266574e-3f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f),
+			  _mm256_set1_ps(9.618437357674640e-3f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f),
+			  _mm256_set1_ps(5.550332471162809e-2f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f),
+			  _mm256_set1_ps(2.402264791363012e-1f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f),
+			  _mm256_set1_ps(6.931472028550421e-1f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+
+	const __m256i scale = _mm256_slli_epi32(
+		_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+}
+
+static AVX2_TARGET inline __m256 pow_avx2(__m256 x, float y)
+{
+	x = _mm256_max_ps(x, _mm256_set1_ps(1.17549435e-38f));
+	return exp2_avx2(_mm256_mul_ps(log2_avx2(x), _mm256_set1_ps(y)));
+}
+
+static AVX2_TARGET inline __m256 to_linear_avx2(__m256 u)
+{
+	const __m256 low = _mm256_div_ps(u, _mm256_set1_ps(12.92f));
+	const __m256 x =
+		_mm256_div_ps(_mm256_add_ps(u, _mm256_set1_ps(0.055f)),
+			      _mm256_set1_ps(1.055f));
+	return _mm256_blendv_ps(
+		pow_avx2(x, 2.4f), low,
+		_mm256_cmp_ps(u, _mm256_set1_ps(0.04045f), _CMP_LE_OQ));
+}
+
+static AVX2_TARGET inline __m256 to_nonlinear_avx2(__m256 u)
+{
+	const __m256 low = _mm256_mul_ps(u, _mm256_set1_ps(12.92f));
+	const __m256 high = _mm256_sub_ps(
+		_mm256_mul_ps(_mm256_set1_ps(1.055f),
+			      pow_avx2(u, 1.0f / 2.4f)),
+		_mm256_set1_ps(0.055f));
+	return _mm256_blendv_ps(
+		high, low,
+		_mm256_cmp_ps(u, _mm256_set1_ps(0.0031308f), _CMP_LE_OQ));
+}
+
+static AVX2_TARGET inline __m256 load8_avx2(const float *p)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)),
+				    _mm_loadu_ps(p + 16), 1);
+}
+
+static AVX2_TARGET inline void store8_avx2(float *p, __m256 v)
+{
+	_mm_storeu_ps(p, _mm256_castps256_ps128(v));
+	_mm_storeu_ps(p + 16, _mm256_extractf128_ps(v, 1));
+}
+
+static AVX2_TARGET void composite8_avx2(float *out, const float *a,
+					const float *b, const float *matte,
+					bool invert, bool linear, bool encode)
+{
+	__m256 ar = load8_avx2(a), ag = load8_avx2(a + 4),
+	       ab = load8_avx2(a + 8), aa = load8_avx2(a + 12);
+	__m256 br = load8_avx2(b), bg = load8_avx2(b + 4),
+	       bb = load8_avx2(b + 8), ba = load8_avx2(b + 12);
+	__m256 mr = load8_avx2(matte), mg = load8_avx2(matte + 4),
+	       mb = load8_avx2(matte + 8), ma = load8_avx2(matte + 12);
+	TRANSPOSE4_256(ar, ag, ab, aa);
+	TRANSPOSE4_256(br, bg, bb, ba);
+	TRANSPOSE4_256(mr, mg, mb, ma);
+
+	__m256 luma = _mm256_add_ps(
+		_mm256_add_ps(_mm256_mul_ps(mr, _mm256_set1_ps(LUMA_R)),
+			      _mm256_mul_ps(mg, _mm256_set1_ps(LUMA_G))),
+		_mm256_mul_ps(mb, _mm256_set1_ps(LUMA_B)));
+	if (invert)
+		luma = _mm256_sub_ps(_mm256_set1_ps(1.0f), luma);
+
+	__m256 r = _mm256_add_ps(ar, _mm256_mul_ps(_mm256_sub_ps(br, ar), luma));
+	__m256 g = _mm256_add_ps(ag, _mm256_mul_ps(_mm256_sub_ps(bg, ag), luma));
+	__m256 bl =
+		_mm256_add_ps(ab, _mm256_mul_ps(_mm256_sub_ps(bb, ab), luma));
+	__m256 al =
+		_mm256_add_ps(aa, _mm256_mul_ps(_mm256_sub_ps(ba, aa), luma));
+	if (!linear) {
+		r = to_linear_avx2(r);
+		g = to_linear_avx2(g);
+		bl = to_linear_avx2(bl);
+	}
+	if (encode) {
+		r = to_nonlinear_avx2(r);
+		g = to_nonlinear_avx2(g);
+		bl = to_nonlinear_avx2(bl);
+	}
+
+	TRANSPOSE4_256(r, g, bl, al);
+	store8_avx2(out, r);
+	store8_avx2(out + 4, g);
+	store8_avx2(out + 8, bl);
+	store8_avx2(out + 12, al);
+}
+
+static AVX2_TARGET void composite_f32_avx2(float *out, const float *a,
+					   const float *b, const float *matte,
+					   size_t pixels, bool invert,
+					   bool linear, bool encode)
+{
+	size_t i = 0;
+	for (; i + 8 <= pixels; i += 8)
+		composite8_avx2(out + i * 4, a + i * 4, b + i * 4,
+				matte + i * 4, invert, linear, encode);
+
+	if (i < pixels) {
+		float ta[32] = {0}, tb[32] = {0}, tm[32] = {0}, to[32];
+		const size_t size = (pixels - i) * 4 * sizeof(float);
+		memcpy(ta, a + i * 4, size);
+		memcpy(tb, b + i * 4, size);
+		memcpy(tm, matte + i * 4, size);
+		composite8_avx2(to, ta, tb, tm, invert, linear, encode);
+		memcpy(out + i * 4, to, size);
+	}
+}
+
+static bool cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	/* avx and osxsave, then the os has to save the ymm registers */
+	if ((info[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+bool matte_composite_has_path(enum matte_composite_path path)
+{
+	switch (path) {
+	case MATTE_COMPOSITE_AUTO:
+	case MATTE_COMPOSITE_SCALAR:
+		return true;
+	case MATTE_COMPOSITE_SSE2:
+#ifdef HAVE_SSE2
+		return true;
+#else
+		return false;
+#endif
+	case MATTE_COMPOSITE_AVX2:
+#ifdef HAVE_AVX2
+		return cpu_has_avx2();
+#else
+		return false;
+#endif
+	}
+	return false;
+}
+
+static enum matte_composite_path resolve_path(enum matte_composite_path path)
+{
+	if (path != MATTE_COMPOSITE_AUTO && matte_composite_has_path(path))
+		return path;
+	if (matte_composite_has_path(MATTE_COMPOSITE_AVX2))
+		return MATTE_COMPOSITE_AVX2;
+	if (matte_composite_has_path(MATTE_COMPOSITE_SSE2))
+		return MATTE_COMPOSITE_SSE2;
+	return MATTE_COMPOSITE_SCALAR;
+}
+
+static void composite_f32(enum matte_composite_path path, float *out,
+			  const float *a, const float *b, const float *matte,
+			  size_t pixels, bool invert, bool linear, bool encode)
+{
+	switch (path) {
+#ifdef HAVE_AVX2
+	case MATTE_COMPOSITE_AVX2:
+		composite_f32_avx2(out, a, b, matte, pixels, invert, linear,
+				   encode);
+		return;
+#endif
+#ifdef HAVE_SSE2
+	case MATTE_COMPOSITE_SSE2:
+		composite_f32_sse2(out, a, b, matte, pixels, invert, linear,
+				   encode);
+		return;
+#endif
+	default:
+		composite_f32_c(out, a, b, matte, pixels, invert, linear,
+				encode);
+		return;
+	}
+}
+
+void matte_composite_f32_path(enum matte_composite_path path, float *out,
+			      const float *a, const float *b,
+			      const float *matte, size_t pixels, bool invert,
+			      bool linear)
+{
+	composite_f32(resolve_path(path), out, a, b, matte, pixels, invert,
+		      linear, false);
+}
+
+void matte_composite_f32(float *out, const float *a, const float *b,
+			 const float *matte, size_t pixels, bool invert,
+			 bool linear)
+{
+	matte_composite_f32_path(MATTE_COMPOSITE_AUTO, out, a, b, matte,
+				 pixels, invert, linear);
+}
+
+static inline uint8_t unorm8(float v)
+{
+	if (!(v > 0.0f))
+		return 0;
+	if (v >= 1.0f)
+		return 255;
+	return (uint8_t)(v * 255.0f + 0.5f);
+}
+
+void matte_composite_rgba8_path(enum matte_composite_path path, uint8_t *out,
+				const uint8_t *a, const uint8_t *b,
+				const uint8_t *matte, size_t pixels,
+				bool invert, bool linear)
+{
+	path = resolve_path(path);
+
+	float unorm_lut[256];
+	float linear_lut[256];
+	for (size_t i = 0; i < 256; i++) {
+		unorm_lut[i] = (float)i / 255.0f;
+		linear_lut[i] = matte_srgb_nonlinear_to_linear(unorm_lut[i]);
+	}
+
+	/* linear techniques sample a and b with sRGB decoding */
+	const float *ab_lut = linear ? linear_lut : unorm_lut;
+
+	float fa[RGBA8_CHUNK * 4];
+	float fb[RGBA8_CHUNK * 4];
+	float fm[RGBA8_CHUNK * 4];
+	float fo[RGBA8_CHUNK * 4];
+
+	for (size_t start = 0; start < pixels; start += RGBA8_CHUNK) {
+		size_t count = pixels - start;
+		if (count > RGBA8_CHUNK)
+			count = RGBA8_CHUNK;
+
+		const size_t base = start * 4;
+		for (size_t i = 0; i < count * 4; i++) {
+			const bool alpha = (i & 3) == 3;
+			fa[i] = alpha ? unorm_lut[a[base + i]]
+				      : ab_lut[a[base + i]];
+			fb[i] = alpha ? unorm_lut[b[base + i]]
+				      : ab_lut[b[base + i]];
+			fm[i] = unorm_lut[matte[base + i]];
+		}
+
+		/* both techniques end in a linear value written to an sRGB
+		 * framebuffer, which encodes it again */
+		composite_f32(path, fo, fa, fb, fm, count, invert, linear,
+			      true);
+
+		for (size_t i = 0; i < count * 4; i++)
+			out[base + i] = unorm8(fo[i]);
+	}
+}
+
+void matte_composite_rgba8(uint8_t *out, const uint8_t *a, const uint8_t *b,
+			   const uint8_t *matte, size_t pixels, bool invert,
+			   bool linear)
+{
+	matte_composite_rgba8_path(MATTE_COMPOSITE_AUTO, out, a, b, matte,
+				   pixels, invert, linear);
+}
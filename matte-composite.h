@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * CPU version of the StingerMatte techniques in matte_transition.effect,
+ * without any libobs dependency.
+ *
+ * matte_composite_f32 works on RGBA float pixels as the shader samples them:
+ * a and b are nonlinear for StingerMatte and linear for StingerMatteLinear.
+ * The StingerMatte output is converted to linear just like the shader does.
+ *
+ * matte_composite_rgba8 works on 8 bit sRGB images and includes the sRGB
+ * framebuffer write, so the result is what ends up on an 8 bit canvas.
+ *
+ * The plain versions pick the fastest path the CPU supports, the _path
+ * versions force one (falling back to auto when it isn't available) so the
+ * SIMD paths can be checked against the scalar one.
+ */
+enum matte_composite_path {
+	MATTE_COMPOSITE_AUTO,
+	MATTE_COMPOSITE_SCALAR,
+	MATTE_COMPOSITE_SSE2,
+	MATTE_COMPOSITE_AVX2,
+};
+
+bool matte_composite_has_path(enum matte_composite_path path);
+
+void matte_composite_f32(float *out, const float *a, const float *b,
+			 const float *matte, size_t pixels, bool invert,
+			 bool linear);
+void matte_composite_rgba8(uint8_t *out, const uint8_t *a, const uint8_t *b,
+			   const uint8_t *matte, size_t pixels, bool invert,
+			   bool linear);
+
+void matte_composite_f32_path(enum matte_composite_path path, float *out,
+			      const float *a, const float *b,
+			      const float *matte, size_t pixels, bool invert,
+			      bool linear);
+void matte_composite_rgba8_path(enum matte_composite_path path, uint8_t *out,
+				const uint8_t *a, const uint8_t *b,
+				const uint8_t *matte, size_t pixels,
+				bool invert, bool linear);
+
+float matte_srgb_nonlinear_to_linear(float u);
+float matte_srgb_linear_to_nonlinear(float u);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,196 @@
+#include "matte-coverage.h"
+#include <util/platform.h>
+#include <util/threading.h>
+
+/* the matte is halved until it fits in this size before it is read back */
+#define COVERAGE_SIZE 16
+#define COVERAGE_LEVELS 12
+/* results are read this many frames after they were staged */
+#define COVERAGE_RING 3
+#define COVERAGE_SMOOTHING 0.35f
+#define COVERAGE_SCALE 1000000L
+
+struct matte_coverage {
+	gs_texrender_t *levels[COVERAGE_LEVELS];
+	gs_stagesurf_t *ring[COVERAGE_RING];
+	uint64_t staged_time[COVERAGE_RING];
+	bool staged_invert[COVERAGE_RING];
+	size_t write;
+	float smoothed;
+
+	volatile bool reset;
+	volatile bool available;
+	volatile long coverage;
+};
+
+struct matte_coverage *matte_coverage_create(void)
+{
+	struct matte_coverage *mc = bzalloc(sizeof(struct matte_coverage));
+	for (size_t i = 0; i < COVERAGE_LEVELS; i++)
+		mc->levels[i] = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	return mc;
+}
+
+void matte_coverage_destroy(struct matte_coverage *mc)
+{
+	if (!mc)
+		return;
+	for (size_t i = 0; i < COVERAGE_LEVELS; i++)
+		gs_texrender_destroy(mc->levels[i]);
+	for (size_t i = 0; i < COVERAGE_RING; i++)
+		gs_stagesurface_destroy(mc->ring[i]);
+	bfree(mc);
+}
+
+void matte_coverage_reset(struct matte_coverage *mc)
+{
+	if (!mc)
+		return;
+	os_atomic_set_bool(&mc->available, false);
+	os_atomic_set_bool(&mc->reset, true);
+}
+
+bool matte_coverage_get(struct matte_coverage *mc, float *coverage)
+{
+	if (!mc || !os_atomic_load_bool(&mc->available))
+		return false;
+	*coverage = (float)os_atomic_load_long(&mc->coverage) /
+		    (float)COVERAGE_SCALE;
+	return true;
+}
+
+uint64_t matte_coverage_get_size(struct matte_coverage *mc)
+{
+	if (!mc)
+		return 0;
+	uint64_t size = 0;
+	for (size_t i = 0; i < COVERAGE_LEVELS; i++) {
+		gs_texture_t *tex = gs_texrender_get_texture(mc->levels[i]);
+		if (tex)
+			size += (uint64_t)gs_texture_get_width(tex) *
+				gs_texture_get_height(tex) *
+				gs_get_format_bpp(
+					gs_texture_get_color_format(tex)) /
+				8;
+	}
+	/* the staging surfaces are always GS_RGBA */
+	for (size_t i = 0; i < COVERAGE_RING; i++)
+		if (mc->ring[i])
+			size += (uint64_t)gs_stagesurface_get_width(
+					mc->ring[i]) *
+				gs_stagesurface_get_height(mc->ring[i]) * 4;
+	return size;
+}
+
+static gs_texture_t *reduce(struct matte_coverage *mc, gs_texture_t *tex)
+{
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	uint32_t cx = gs_texture_get_width(tex);
+	uint32_t cy = gs_texture_get_height(tex);
+
+	/* every 2x2 block is averaged by the linear sampler, always do at
+	 * least one pass so the result is in a readable 8 bit format */
+	size_t level = 0;
+	do {
+		cx = cx > 1 ? cx / 2 : 1;
+		cy = cy > 1 ? cy / 2 : 1;
+
+		gs_texrender_t *target = mc->levels[level];
+		gs_texrender_reset(target);
+		if (!gs_texrender_begin(target, cx, cy))
+			return NULL;
+
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+		gs_blend_state_push();
+		gs_enable_blending(false);
+		gs_effect_set_texture(image, tex);
+		while (gs_effect_loop(effect, "Draw"))
+			gs_draw_sprite(tex, 0, cx, cy);
+		gs_blend_state_pop();
+		gs_texrender_end(target);
+
+		tex = gs_texrender_get_texture(target);
+		level++;
+	} while ((cx > COVERAGE_SIZE || cy > COVERAGE_SIZE) &&
+		 level < COVERAGE_LEVELS);
+
+	return tex;
+}
+
+static float average_luma(const uint8_t *data, uint32_t linesize,
+			  uint32_t cx, uint32_t cy)
+{
+	double total = 0.0;
+	for (uint32_t y = 0; y < cy; y++) {
+		const uint8_t *pixel = data + (size_t)y * linesize;
+		for (uint32_t x = 0; x < cx; x++, pixel += 4) {
+			/* Rec. 709 factors, same as matte_transition.effect */
+			total += pixel[0] * 0.2126 + pixel[1] * 0.7152 +
+				 pixel[2] * 0.0722;
+		}
+	}
+	return (float)(total / (255.0 * (double)cx * (double)cy));
+}
+
+uint64_t matte_coverage_update(struct matte_coverage *mc, gs_texture_t *matte,
+			       bool invert)
+{
+	if (!mc || !matte)
+		return 0;
+
+	if (os_atomic_load_bool(&mc->reset)) {
+		os_atomic_set_bool(&mc->reset, false);
+		for (size_t i = 0; i < COVERAGE_RING; i++)
+			mc->staged_time[i] = 0;
+	}
+
+	gs_texture_t *tex = reduce(mc, matte);
+	if (!tex)
+		return 0;
+
+	const uint32_t cx = gs_texture_get_width(tex);
+	const uint32_t cy = gs_texture_get_height(tex);
+	gs_stagesurf_t **stage = &mc->ring[mc->write];
+	if (!*stage || gs_stagesurface_get_width(*stage) != cx ||
+	    gs_stagesurface_get_height(*stage) != cy) {
+		gs_stagesurface_destroy(*stage);
+		*stage = gs_stagesurface_create(cx, cy, GS_RGBA);
+	}
+	if (!*stage)
+		return 0;
+
+	gs_stage_texture(*stage, tex);
+	mc->staged_time[mc->write] = os_gettime_ns();
+	mc->staged_invert[mc->write] = invert;
+	mc->write = (mc->write + 1) % COVERAGE_RING;
+
+	/* the slot after the one just written is the oldest one */
+	const size_t read = mc->write;
+	const uint64_t staged_time = mc->staged_time[read];
+	if (!staged_time || !mc->ring[read])
+		return 0;
+	mc->staged_time[read] = 0;
+
+	uint8_t *data;
+	uint32_t linesize;
+	if (!gs_stagesurface_map(mc->ring[read], &data, &linesize))
+		return 0;
+	float coverage = average_luma(data, linesize,
+				      gs_stagesurface_get_width(mc->ring[read]),
+				      gs_stagesurface_get_height(mc->ring[read]));
+	gs_stagesurface_unmap(mc->ring[read]);
+
+	if (mc->staged_invert[read])
+		coverage = 1.0f - coverage;
+
+	if (os_atomic_load_bool(&mc->available))
+		mc->smoothed += (coverage - mc->smoothed) * COVERAGE_SMOOTHING;
+	else
+		mc->smoothed = coverage;
+	os_atomic_set_long(&mc->coverage,
+			   (long)(mc->smoothed * (float)COVERAGE_SCALE));
+	os_atomic_set_bool(&mc->available, true);
+
+	return os_gettime_ns() - staged_time;
+}
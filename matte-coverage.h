@@ -0,0 +1,20 @@
+#pragma once
+
+#include "obs-module.h"
+
+struct matte_coverage;
+
+/* create, destroy and update need the graphics context */
+struct matte_coverage *matte_coverage_create(void);
+void matte_coverage_destroy(struct matte_coverage *mc);
+
+/* reduces the matte on the gpu and reads back an older frame, returns the
+ * readback latency in ns or 0 when no result was read this frame */
+uint64_t matte_coverage_update(struct matte_coverage *mc, gs_texture_t *matte,
+			       bool invert);
+/* bytes of video memory held by the reduce targets and staging surfaces */
+uint64_t matte_coverage_get_size(struct matte_coverage *mc);
+
+/* safe from any thread */
+void matte_coverage_reset(struct matte_coverage *mc);
+bool matte_coverage_get(struct matte_coverage *mc, float *coverage);
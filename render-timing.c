@@ -0,0 +1,327 @@
+#include "render-timing.h"
+#include <util/threading.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* queries are read back this many frames later so the gpu never stalls */
+#define RENDER_TIMING_FRAMES 4
+#define RENDER_TIMING_SAMPLES 256
+
+static const char *render_pass_names[RENDER_PASS_COUNT] = {
+	"browser",
+	"matte",
+	"stinger",
+	"composite",
+};
+
+static const char *render_cpu_names[RENDER_CPU_COUNT] = {
+	"start",
+	"restart",
+	"readback",
+};
+
+struct render_timing_slot {
+	gs_timer_range_t *range;
+	gs_timer_t *timers[RENDER_PASS_COUNT];
+	bool used[RENDER_PASS_COUNT];
+	bool pending;
+};
+
+struct render_timing_samples {
+	float ms[RENDER_TIMING_SAMPLES];
+	size_t count;
+	size_t next;
+};
+
+struct render_timing {
+	struct render_timing_slot slots[RENDER_TIMING_FRAMES];
+	size_t current;
+	bool in_frame;
+
+	pthread_mutex_t mutex;
+	struct render_timing_samples samples[RENDER_PASS_COUNT];
+	struct render_timing_samples cpu_samples[RENDER_CPU_COUNT];
+	uint64_t dropped;
+	/* frames timed since the adaptive quality last took them */
+	float window_ms;
+	uint32_t window_frames;
+	uint64_t vram;
+	uint64_t vram_peak;
+};
+
+struct render_timing *render_timing_create(void)
+{
+	struct render_timing *rt = bzalloc(sizeof(struct render_timing));
+	pthread_mutex_init(&rt->mutex, NULL);
+	for (size_t i = 0; i < RENDER_TIMING_FRAMES; i++) {
+		struct render_timing_slot *slot = &rt->slots[i];
+		slot->range = gs_timer_range_create();
+		for (size_t pass = 0; pass < RENDER_PASS_COUNT; pass++)
+			slot->timers[pass] = gs_timer_create();
+	}
+	return rt;
+}
+
+void render_timing_destroy(struct render_timing *rt)
+{
+	if (!rt)
+		return;
+	for (size_t i = 0; i < RENDER_TIMING_FRAMES; i++) {
+		struct render_timing_slot *slot = &rt->slots[i];
+		for (size_t pass = 0; pass < RENDER_PASS_COUNT; pass++)
+			gs_timer_destroy(slot->timers[pass]);
+		gs_timer_range_destroy(slot->range);
+	}
+	pthread_mutex_destroy(&rt->mutex);
+	bfree(rt);
+}
+
+static void add_sample(struct render_timing_samples *samples, float ms)
+{
+	samples->ms[samples->next] = ms;
+	samples->next = (samples->next + 1) % RENDER_TIMING_SAMPLES;
+	if (samples->count < RENDER_TIMING_SAMPLES)
+		samples->count++;
+}
+
+static bool collect_slot(struct render_timing *rt,
+			 struct render_timing_slot *slot)
+{
+	bool disjoint;
+	uint64_t frequency;
+	if (!gs_timer_range_get_data(slot->range, &disjoint, &frequency))
+		return false;
+
+	float ms[RENDER_PASS_COUNT];
+	bool valid[RENDER_PASS_COUNT] = {0};
+	for (size_t pass = 0; pass < RENDER_PASS_COUNT; pass++) {
+		uint64_t ticks;
+		if (!slot->used[pass] || disjoint || !frequency)
+			continue;
+		if (!gs_timer_get_data(slot->timers[pass], &ticks))
+			return false;
+		ms[pass] = (float)((double)ticks * 1000.0 / (double)frequency);
+		valid[pass] = true;
+	}
+
+	float frame_ms = 0.0f;
+	bool timed = false;
+	pthread_mutex_lock(&rt->mutex);
+	for (size_t pass = 0; pass < RENDER_PASS_COUNT; pass++) {
+		if (!valid[pass])
+			continue;
+		add_sample(&rt->samples[pass], ms[pass]);
+		frame_ms += ms[pass];
+		timed = true;
+	}
+	if (timed) {
+		rt->window_ms += frame_ms;
+		rt->window_frames++;
+	}
+	pthread_mutex_unlock(&rt->mutex);
+	return true;
+}
+
+void render_timing_frame_begin(struct render_timing *rt)
+{
+	if (!rt || rt->in_frame)
+		return;
+
+	for (size_t i = 1; i < RENDER_TIMING_FRAMES; i++) {
+		struct render_timing_slot *slot =
+			&rt->slots[(rt->current + i) % RENDER_TIMING_FRAMES];
+		if (slot->pending && collect_slot(rt, slot))
+			slot->pending = false;
+	}
+
+	struct render_timing_slot *slot = &rt->slots[rt->current];
+	if (slot->pending) {
+		/* results still not available, reuse the slot rather than wait */
+		pthread_mutex_lock(&rt->mutex);
+		rt->dropped++;
+		pthread_mutex_unlock(&rt->mutex);
+		slot->pending = false;
+	}
+	if (!slot->range)
+		return;
+
+	memset(slot->used, 0, sizeof(slot->used));
+	gs_timer_range_begin(slot->range);
+	rt->in_frame = true;
+}
+
+void render_timing_frame_end(struct render_timing *rt)
+{
+	if (!rt || !rt->in_frame)
+		return;
+
+	struct render_timing_slot *slot = &rt->slots[rt->current];
+	gs_timer_range_end(slot->range);
+	slot->pending = true;
+	rt->in_frame = false;
+	rt->current = (rt->current + 1) % RENDER_TIMING_FRAMES;
+}
+
+void render_timing_pass_begin(struct render_timing *rt, enum render_pass pass)
+{
+	if (!rt || !rt->in_frame)
+		return;
+	struct render_timing_slot *slot = &rt->slots[rt->current];
+	if (!slot->timers[pass] || slot->used[pass])
+		return;
+	gs_timer_begin(slot->timers[pass]);
+}
+
+void render_timing_pass_end(struct render_timing *rt, enum render_pass pass)
+{
+	if (!rt || !rt->in_frame)
+		return;
+	struct render_timing_slot *slot = &rt->slots[rt->current];
+	if (!slot->timers[pass] || slot->used[pass])
+		return;
+	gs_timer_end(slot->timers[pass]);
+	slot->used[pass] = true;
+}
+
+void render_timing_set_vram(struct render_timing *rt, uint64_t bytes)
+{
+	if (!rt)
+		return;
+	pthread_mutex_lock(&rt->mutex);
+	rt->vram = bytes;
+	if (bytes > rt->vram_peak)
+		rt->vram_peak = bytes;
+	pthread_mutex_unlock(&rt->mutex);
+}
+
+void render_timing_add_cpu(struct render_timing *rt,
+			   enum render_cpu_timing which, uint64_t ns)
+{
+	if (!rt)
+		return;
+	pthread_mutex_lock(&rt->mutex);
+	add_sample(&rt->cpu_samples[which], (float)((double)ns / 1000000.0));
+	pthread_mutex_unlock(&rt->mutex);
+}
+
+static int compare_float(const void *a, const void *b)
+{
+	const float fa = *(const float *)a;
+	const float fb = *(const float *)b;
+	return (fa > fb) - (fa < fb);
+}
+
+struct pass_stats {
+	size_t count;
+	float min;
+	float avg;
+	float p99;
+};
+
+static void calc_pass_stats(const struct render_timing_samples *samples,
+			    struct pass_stats *stats)
+{
+	float sorted[RENDER_TIMING_SAMPLES];
+	stats->count = samples->count;
+	if (!samples->count) {
+		stats->min = stats->avg = stats->p99 = 0.0f;
+		return;
+	}
+	memcpy(sorted, samples->ms, samples->count * sizeof(float));
+	qsort(sorted, samples->count, sizeof(float), compare_float);
+
+	double total = 0.0;
+	for (size_t i = 0; i < samples->count; i++)
+		total += sorted[i];
+	stats->min = sorted[0];
+	stats->avg = (float)(total / (double)samples->count);
+	stats->p99 = sorted[(samples->count - 1) * 99 / 100];
+}
+
+uint32_t render_timing_take_frames(struct render_timing *rt, float *pass_ms)
+{
+	*pass_ms = 0.0f;
+	if (!rt)
+		return 0;
+
+	pthread_mutex_lock(&rt->mutex);
+	const uint32_t frames = rt->window_frames;
+	*pass_ms = rt->window_ms;
+	rt->window_ms = 0.0f;
+	rt->window_frames = 0;
+	pthread_mutex_unlock(&rt->mutex);
+	return frames;
+}
+
+static void set_pass_stats(obs_data_t *data, const char *name,
+			   const struct pass_stats *stats)
+{
+	obs_data_t *p = obs_data_create();
+	obs_data_set_int(p, "samples", (long long)stats->count);
+	obs_data_set_double(p, "min", stats->min);
+	obs_data_set_double(p, "avg", stats->avg);
+	obs_data_set_double(p, "p99", stats->p99);
+	obs_data_set_obj(data, name, p);
+	obs_data_release(p);
+}
+
+void render_timing_get_stats(struct render_timing *rt, obs_data_t *data)
+{
+	struct pass_stats stats[RENDER_PASS_COUNT];
+	struct pass_stats cpu_stats[RENDER_CPU_COUNT];
+	pthread_mutex_lock(&rt->mutex);
+	for (size_t pass = 0; pass < RENDER_PASS_COUNT; pass++)
+		calc_pass_stats(&rt->samples[pass], &stats[pass]);
+	for (size_t cpu = 0; cpu < RENDER_CPU_COUNT; cpu++)
+		calc_pass_stats(&rt->cpu_samples[cpu], &cpu_stats[cpu]);
+	const uint64_t dropped = rt->dropped;
+	const uint64_t vram = rt->vram;
+	const uint64_t vram_peak = rt->vram_peak;
+	pthread_mutex_unlock(&rt->mutex);
+
+	for (size_t pass = 0; pass < RENDER_PASS_COUNT; pass++)
+		set_pass_stats(data, render_pass_names[pass], &stats[pass]);
+	for (size_t cpu = 0; cpu < RENDER_CPU_COUNT; cpu++)
+		set_pass_stats(data, render_cpu_names[cpu], &cpu_stats[cpu]);
+	obs_data_set_int(data, "dropped", (long long)dropped);
+	obs_data_set_int(data, "vram", (long long)vram);
+	obs_data_set_int(data, "vramPeak", (long long)vram_peak);
+}
+
+void render_timing_log(struct render_timing *rt, const char *name)
+{
+	if (!rt)
+		return;
+
+	struct pass_stats stats[RENDER_PASS_COUNT];
+	struct pass_stats cpu_stats[RENDER_CPU_COUNT];
+	pthread_mutex_lock(&rt->mutex);
+	for (size_t pass = 0; pass < RENDER_PASS_COUNT; pass++)
+		calc_pass_stats(&rt->samples[pass], &stats[pass]);
+	for (size_t cpu = 0; cpu < RENDER_CPU_COUNT; cpu++)
+		calc_pass_stats(&rt->cpu_samples[cpu], &cpu_stats[cpu]);
+	const uint64_t vram_peak = rt->vram_peak;
+	pthread_mutex_unlock(&rt->mutex);
+
+	for (size_t pass = 0; pass < RENDER_PASS_COUNT; pass++) {
+		if (!stats[pass].count)
+			continue;
+		blog(LOG_INFO,
+		     "[Browser Transition] '%s' %s pass: min %.3f ms, avg %.3f ms, p99 %.3f ms (%zu samples)",
+		     name, render_pass_names[pass], stats[pass].min,
+		     stats[pass].avg, stats[pass].p99, stats[pass].count);
+	}
+	for (size_t cpu = 0; cpu < RENDER_CPU_COUNT; cpu++) {
+		if (!cpu_stats[cpu].count)
+			continue;
+		blog(LOG_INFO,
+		     "[Browser Transition] '%s' %s latency: min %.3f ms, avg %.3f ms, p99 %.3f ms (%zu samples)",
+		     name, render_cpu_names[cpu], cpu_stats[cpu].min,
+		     cpu_stats[cpu].avg, cpu_stats[cpu].p99,
+		     cpu_stats[cpu].count);
+	}
+	if (vram_peak)
+		blog(LOG_INFO,
+		     "[Browser Transition] '%s' render targets peak: %.1f MB",
+		     name, (double)vram_peak / (1024.0 * 1024.0));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "obs-module.h"
+
+enum render_pass {
+	RENDER_PASS_BROWSER,
+	RENDER_PASS_MATTE,
+	RENDER_PASS_STINGER,
+	RENDER_PASS_COMPOSITE,
+	RENDER_PASS_COUNT,
+};
+
+enum render_cpu_timing {
+	RENDER_CPU_START,
+	RENDER_CPU_RESTART,
+	RENDER_CPU_READBACK,
+	RENDER_CPU_COUNT,
+};
+
+struct render_timing;
+
+/* create and destroy need the graphics context */
+struct render_timing *render_timing_create(void);
+void render_timing_destroy(struct render_timing *rt);
+
+/* graphics thread only, called around every video_render */
+void render_timing_frame_begin(struct render_timing *rt);
+void render_timing_frame_end(struct render_timing *rt);
+void render_timing_pass_begin(struct render_timing *rt, enum render_pass pass);
+void render_timing_pass_end(struct render_timing *rt, enum render_pass pass);
+void render_timing_set_vram(struct render_timing *rt, uint64_t bytes);
+
+/* safe from any thread */
+void render_timing_add_cpu(struct render_timing *rt,
+			   enum render_cpu_timing which, uint64_t ns);
+/* frames timed since the last call, pass_ms gets the sum of their passes,
+ * roughly the gpu time the transition took over those frames */
+uint32_t render_timing_take_frames(struct render_timing *rt, float *pass_ms);
+void render_timing_get_stats(struct render_timing *rt, obs_data_t *data);
+void render_timing_log(struct render_timing *rt, const char *name);
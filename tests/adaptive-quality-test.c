@@ -0,0 +1,122 @@
+/*
+ * Adaptive quality on the stub libobs: slow gpu timers step a transition
+ * down to a direct cut one level at a time, fast ones step it back up to
+ * full quality again, and lag keeps it at a direct cut.
+ *
+ *   adaptive-quality-test
+ */
+#include "obs-stub.h"
+#include "adaptive-quality.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* over half of the 16.7 ms frame budget at 60 fps */
+#define SLOW_NS 12000000u
+#define FAST_NS 100000u
+#define FRAMES_PER_TRANSITION 120
+
+static int failures;
+
+static void expect(bool ok, const char *what)
+{
+	if (!ok) {
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+}
+
+static enum quality_level get_level(obs_source_t *transition)
+{
+	calldata_t cd = {0};
+	const char *json = NULL;
+	long level = -1;
+	proc_handler_call(obs_source_get_proc_handler(transition),
+			  "get_render_stats", &cd);
+	if (calldata_get_string(&cd, "json", &json) && json) {
+		const char *key = strstr(json, "\"qualityLevel\":");
+		if (key)
+			level = strtol(key + strlen("\"qualityLevel\":"), NULL,
+				       10);
+	}
+	calldata_free(&cd);
+	return (enum quality_level)level;
+}
+
+/* two seconds of transition, lagged adds that many frames every tick */
+static void run_transition(obs_source_t *transition, uint32_t lagged)
+{
+	stub_transition_set_time(transition, 0.0f);
+	stub_transition_start(transition);
+	for (int i = 1; i <= FRAMES_PER_TRANSITION; i++) {
+		if (lagged)
+			stub_add_lagged_frames(lagged);
+		stub_video_tick(1.0f / 60.0f);
+		stub_transition_set_time(transition,
+					 (float)i / FRAMES_PER_TRANSITION);
+		stub_video_render(transition);
+	}
+	stub_transition_stop(transition);
+}
+
+int main(void)
+{
+	stub_set_log_level(LOG_WARNING);
+	obs_module_load();
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_bool(settings, "adaptive_quality", true);
+	obs_data_set_double(settings, "duration", 2000.0);
+	obs_source_t *transition =
+		stub_transition_create("Adaptive", settings);
+	obs_data_release(settings);
+	if (!transition) {
+		printf("FAIL could not create the transition\n");
+		return 1;
+	}
+
+	/* only frames rendered at a level judge it, one step at a time */
+	stub_set_timer_ns(SLOW_NS);
+	enum quality_level level = get_level(transition);
+	expect(level == QUALITY_FULL, "starts at full quality");
+	int transitions = 0;
+	while (level < QUALITY_DIRECT_CUT && transitions++ < 16) {
+		run_transition(transition, 0);
+		const enum quality_level next = get_level(transition);
+		if (next > level + 1) {
+			printf("FAIL stepped from %d to %d in one transition\n",
+			       level, next);
+			failures++;
+		}
+		level = next;
+	}
+	expect(level == QUALITY_DIRECT_CUT, "slow passes reach a direct cut");
+	printf("direct cut after %d transitions\n", transitions);
+
+	/* a direct cut renders no passes, lag alone keeps it there */
+	stub_set_timer_ns(FAST_NS);
+	for (int i = 0; i < 4; i++)
+		run_transition(transition, 1);
+	expect(get_level(transition) == QUALITY_DIRECT_CUT,
+	       "lag keeps a direct cut");
+
+	/* without lag and with fast passes it recovers, the old pass times
+	 * from before the direct cut must not hold it down */
+	transitions = 0;
+	while (level > QUALITY_FULL && transitions++ < 64) {
+		run_transition(transition, 0);
+		level = get_level(transition);
+	}
+	expect(level == QUALITY_FULL, "fast passes recover full quality");
+	printf("full quality after %d transitions\n", transitions);
+
+	obs_source_release(transition);
+	obs_module_unload();
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	return 0;
+}
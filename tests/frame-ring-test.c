@@ -0,0 +1,160 @@
+/*
+ * Jitter buffer on the stub libobs: a browser that stalls for a few paints
+ * plays on without showing a picture twice as long as the buffered frames
+ * last, a longer stall holds the last picture and picks up right after,
+ * and a browser running at half the frame rate isn't mistaken for one
+ * that stalls.
+ *
+ *   frame-ring-test
+ */
+#include "obs-stub.h"
+#include "frame-ring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DEPTH 4
+#define FRAMES 64
+#define STALL_AT 24
+
+static int failures;
+
+static void expect(bool ok, const char *what)
+{
+	if (!ok) {
+		printf("FAIL %s\n", what);
+		failures++;
+	}
+}
+
+struct run {
+	uint32_t shown[FRAMES];
+	long long repeated;
+	long long skipped;
+	long long underruns;
+};
+
+/* interval is the paint interval of the browser and the one the ring is
+ * told about, stall paints are left out from STALL_AT on */
+static void run_ring(obs_source_t *browser, uint32_t interval, uint32_t stall,
+		     struct run *run)
+{
+	stub_set_paint_interval(interval);
+	obs_enter_graphics();
+	struct frame_ring *ring = frame_ring_create(DEPTH);
+	frame_ring_set_interval(ring, interval);
+	obs_leave_graphics();
+
+	for (int i = 0; i < FRAMES; i++) {
+		if (i == STALL_AT)
+			stub_stall_paints(stall);
+		stub_video_tick(1.0f / 60.0f);
+		obs_enter_graphics();
+		frame_ring_tick(ring);
+		frame_ring_update(ring, browser);
+		run->shown[i] = stub_texture_get_picture(frame_ring_get(ring));
+		obs_leave_graphics();
+	}
+
+	obs_data_t *data = obs_data_create();
+	frame_ring_get_stats(ring, data);
+	obs_data_t *stats = obs_data_get_obj(data, "jitterBuffer");
+	run->repeated = obs_data_get_int(stats, "repeated");
+	run->skipped = obs_data_get_int(stats, "skipped");
+	run->underruns = obs_data_get_int(stats, "underruns");
+	obs_data_release(stats);
+	obs_data_release(data);
+
+	obs_enter_graphics();
+	frame_ring_destroy(ring);
+	obs_leave_graphics();
+}
+
+static void print_run(const char *name, const struct run *run)
+{
+	printf("%-10s", name);
+	for (int i = 0; i < FRAMES; i++)
+		printf(" %u", run->shown[i]);
+	printf("\n%-10s %lld repeated, %lld skipped, %lld underruns\n", "",
+	       run->repeated, run->skipped, run->underruns);
+}
+
+/* frames the picture didn't advance by one after the first one shown */
+static int count_holds(const struct run *run, int *jumps)
+{
+	int holds = 0;
+	*jumps = 0;
+	for (int i = 1; i < FRAMES; i++) {
+		if (!run->shown[i - 1])
+			continue;
+		if (run->shown[i] == run->shown[i - 1])
+			holds++;
+		else if (run->shown[i] != run->shown[i - 1] + 1)
+			(*jumps)++;
+	}
+	return holds;
+}
+
+int main(void)
+{
+	stub_set_log_level(LOG_WARNING);
+
+	obs_source_t *parent =
+		stub_source_create("scene", "Scene", 1920, 1080);
+	obs_source_t *browser =
+		stub_source_create("browser_source", "Browser", 1920, 1080);
+	obs_source_add_active_child(parent, browser);
+
+	struct run run;
+	int jumps;
+
+	/* a stall shorter than the buffer is skipped over, the picture
+	 * still advances every frame */
+	memset(&run, 0, sizeof(run));
+	run_ring(browser, 1, DEPTH - 1, &run);
+	print_run("short", &run);
+	expect(run.shown[DEPTH] != 0, "shows a picture once primed");
+	expect(count_holds(&run, &jumps) == 0, "short stall is not shown");
+	expect(jumps == 0, "short stall doesn't skip paints");
+	expect(run.repeated == DEPTH - 1, "short stall is counted");
+	expect(run.skipped == DEPTH - 1, "short stall is skipped");
+	expect(run.underruns == 0, "short stall doesn't underrun");
+
+	/* a longer one holds the last picture for the rest, the frame still
+	 * waiting for its readback isn't skipped */
+	memset(&run, 0, sizeof(run));
+	run_ring(browser, 1, DEPTH * 2, &run);
+	print_run("long", &run);
+	const int holds = count_holds(&run, &jumps);
+	expect(holds == DEPTH * 2 - (DEPTH - 1),
+	       "long stall holds the frames it exceeds the buffer by");
+	expect(jumps == 0, "long stall doesn't skip paints");
+	expect(run.underruns == holds, "long stall counts the held frames");
+
+	/* half the frame rate repeats every picture once by design */
+	memset(&run, 0, sizeof(run));
+	run_ring(browser, 2, 0, &run);
+	print_run("half", &run);
+	count_holds(&run, &jumps);
+	for (int i = DEPTH + 2; i < FRAMES; i++)
+		if (run.shown[i] == run.shown[i - 2])
+			jumps++;
+	expect(jumps == 0, "half frame rate shows every picture twice");
+	expect(run.repeated == 0 && run.skipped == 0,
+	       "half frame rate isn't a stall");
+
+	obs_source_remove_active_child(parent, browser);
+	obs_source_release(browser);
+	obs_source_release(parent);
+
+	struct stub_counts counts;
+	stub_get_counts(&counts);
+	expect(!counts.texrenders && !counts.stagesurfs, "ring leaks nothing");
+	expect(!counts.graphics_violations, "graphics calls in the context");
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	return 0;
+}
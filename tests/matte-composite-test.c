@@ -0,0 +1,304 @@
+/*
+ * Checks the CPU matte composite against checked-in goldens and the SIMD
+ * paths against the scalar one.
+ *
+ *   matte-composite-test <golden dir> [--update]
+ *
+ * --update rewrites the goldens from the scalar path.
+ */
+#include "matte-composite.h"
+#include "stub/test-random.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WIDTH 32
+#define HEIGHT 16
+#define PIXELS (WIDTH * HEIGHT)
+#define RANDOM_PIXELS 1021
+
+enum layout {
+	LAYOUT_HORIZONTAL,
+	LAYOUT_VERTICAL,
+	LAYOUT_MASK,
+	LAYOUT_COUNT,
+};
+
+static const char *layout_names[LAYOUT_COUNT] = {"horizontal", "vertical",
+						  "mask"};
+
+static const struct {
+	enum matte_composite_path path;
+	const char *name;
+} paths[] = {
+	{MATTE_COMPOSITE_SCALAR, "scalar"},
+	{MATTE_COMPOSITE_SSE2, "sse2"},
+	{MATTE_COMPOSITE_AVX2, "avx2"},
+};
+
+static int failures;
+
+static float random_unit(uint32_t *state)
+{
+	return (float)test_random(state) / (float)(1u << 24);
+}
+
+static void fail(const char *fmt, const char *a, const char *b, bool invert,
+		 bool linear, size_t index)
+{
+	printf("FAIL %s %s invert=%d linear=%d at %zu: %s\n", a, b, invert,
+	       linear, index, fmt);
+	failures++;
+}
+
+/* a packed media frame with the stinger and matte next to or above each
+ * other, or only a matte for the mask layout */
+static void make_packed(uint8_t *packed, uint32_t *cx, uint32_t *cy,
+			enum layout layout)
+{
+	*cx = layout == LAYOUT_HORIZONTAL ? WIDTH * 2 : WIDTH;
+	*cy = layout == LAYOUT_VERTICAL ? HEIGHT * 2 : HEIGHT;
+
+	uint32_t state = 0x5eed + layout;
+	for (uint32_t y = 0; y < *cy; y++) {
+		for (uint32_t x = 0; x < *cx; x++) {
+			uint8_t *p = packed + (y * *cx + x) * 4;
+			/* a soft diagonal wipe with some noise in it */
+			const int ramp = (int)(x % WIDTH) * 8 - (int)y * 4;
+			const int noise = (int)(test_random(&state) & 31) - 16;
+			int v = ramp + noise;
+			v = v < 0 ? 0 : (v > 255 ? 255 : v);
+			p[0] = (uint8_t)v;
+			p[1] = (uint8_t)(255 - v);
+			p[2] = (uint8_t)(test_random(&state) & 255);
+			p[3] = 255;
+		}
+	}
+}
+
+static void extract_matte(uint8_t *matte, const uint8_t *packed, uint32_t cx,
+			  enum layout layout)
+{
+	const uint32_t x0 = layout == LAYOUT_HORIZONTAL ? WIDTH : 0;
+	const uint32_t y0 = layout == LAYOUT_VERTICAL ? HEIGHT : 0;
+	for (uint32_t y = 0; y < HEIGHT; y++)
+		memcpy(matte + y * WIDTH * 4,
+		       packed + ((y0 + y) * cx + x0) * 4, WIDTH * 4);
+}
+
+static void make_sources(uint8_t *a, uint8_t *b)
+{
+	for (uint32_t y = 0; y < HEIGHT; y++) {
+		for (uint32_t x = 0; x < WIDTH; x++) {
+			uint8_t *pa = a + (y * WIDTH + x) * 4;
+			uint8_t *pb = b + (y * WIDTH + x) * 4;
+			pa[0] = (uint8_t)(x * 8);
+			pa[1] = (uint8_t)(y * 16);
+			pa[2] = 200;
+			pa[3] = 255;
+			pb[0] = 30;
+			pb[1] = (uint8_t)(255 - x * 8);
+			pb[2] = (uint8_t)(x * y);
+			pb[3] = (uint8_t)(128 + y * 8);
+		}
+	}
+}
+
+static bool read_file(const char *path, uint8_t *data, size_t size)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return false;
+	const bool ok = fread(data, 1, size, f) == size && fgetc(f) == EOF;
+	fclose(f);
+	return ok;
+}
+
+static bool write_file(const char *path, const uint8_t *data, size_t size)
+{
+	FILE *f = fopen(path, "wb");
+	if (!f)
+		return false;
+	const bool ok = fwrite(data, 1, size, f) == size;
+	return fclose(f) == 0 && ok;
+}
+
+/* allow one step for powf differences between C libraries */
+static bool compare_rgba8(const uint8_t *x, const uint8_t *y, size_t size,
+			  size_t *index)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (abs((int)x[i] - (int)y[i]) > 1) {
+			*index = i / 4;
+			return false;
+		}
+	}
+	return true;
+}
+
+static void check_goldens(const char *dir, bool update)
+{
+	static uint8_t packed[PIXELS * 4 * 2];
+	static uint8_t a[PIXELS * 4], b[PIXELS * 4], matte[PIXELS * 4];
+	static uint8_t out[PIXELS * 4], golden[PIXELS * 4];
+	char path[1024];
+
+	make_sources(a, b);
+
+	for (int layout = 0; layout < LAYOUT_COUNT; layout++) {
+		uint32_t cx, cy;
+		make_packed(packed, &cx, &cy, (enum layout)layout);
+		extract_matte(matte, packed, cx, (enum layout)layout);
+
+		for (int invert = 0; invert < 2; invert++) {
+			for (int linear = 0; linear < 2; linear++) {
+				snprintf(path, sizeof(path),
+					 "%s/%s-%s-%s.rgba", dir,
+					 layout_names[layout],
+					 invert ? "invert" : "normal",
+					 linear ? "linear" : "srgb");
+
+				matte_composite_rgba8_path(
+					MATTE_COMPOSITE_SCALAR, out, a, b,
+					matte, PIXELS, invert, linear);
+				if (update) {
+					if (!write_file(path, out,
+							sizeof(out))) {
+						printf("FAIL writing %s\n",
+						       path);
+						failures++;
+					}
+					continue;
+				}
+
+				if (!read_file(path, golden, sizeof(golden))) {
+					printf("FAIL reading %s\n", path);
+					failures++;
+					continue;
+				}
+
+				for (size_t p = 0;
+				     p < sizeof(paths) / sizeof(paths[0]);
+				     p++) {
+					size_t index;
+					if (!matte_composite_has_path(
+						    paths[p].path))
+						continue;
+					matte_composite_rgba8_path(
+						paths[p].path, out, a, b,
+						matte, PIXELS, invert, linear);
+					if (!compare_rgba8(out, golden,
+							   sizeof(out),
+							   &index))
+						fail("differs from golden",
+						     layout_names[layout],
+						     paths[p].name, invert,
+						     linear, index);
+				}
+			}
+		}
+	}
+}
+
+static void check_simd_against_scalar(void)
+{
+	static float a[RANDOM_PIXELS * 4], b[RANDOM_PIXELS * 4];
+	static float matte[RANDOM_PIXELS * 4];
+	static float expected[RANDOM_PIXELS * 4], out[RANDOM_PIXELS * 4 + 4];
+	static uint8_t a8[RANDOM_PIXELS * 4], b8[RANDOM_PIXELS * 4];
+	static uint8_t matte8[RANDOM_PIXELS * 4];
+	static uint8_t expected8[RANDOM_PIXELS * 4], out8[RANDOM_PIXELS * 4];
+
+	uint32_t state = 1;
+	for (size_t i = 0; i < RANDOM_PIXELS * 4; i++) {
+		a[i] = random_unit(&state);
+		b[i] = random_unit(&state);
+		matte[i] = random_unit(&state);
+		a8[i] = (uint8_t)test_random(&state);
+		b8[i] = (uint8_t)test_random(&state);
+		matte8[i] = (uint8_t)test_random(&state);
+	}
+
+	/* odd counts so the padded tails get checked as well */
+	static const size_t counts[] = {1, 3, 5, 7, 9, 64, 67, RANDOM_PIXELS};
+
+	for (size_t p = 1; p < sizeof(paths) / sizeof(paths[0]); p++) {
+		if (!matte_composite_has_path(paths[p].path)) {
+			printf("skip %s, not supported here\n", paths[p].name);
+			continue;
+		}
+
+		for (int invert = 0; invert < 2; invert++) {
+			for (int linear = 0; linear < 2; linear++) {
+				for (size_t c = 0;
+				     c < sizeof(counts) / sizeof(counts[0]);
+				     c++) {
+					const size_t n = counts[c];
+					size_t index;
+
+					matte_composite_f32_path(
+						MATTE_COMPOSITE_SCALAR,
+						expected, a, b, matte, n,
+						invert, linear);
+					memset(out, 0, sizeof(out));
+					matte_composite_f32_path(
+						paths[p].path, out, a, b,
+						matte, n, invert, linear);
+					for (index = 0; index < n * 4;
+					     index++) {
+						const float e = expected[index];
+						const float d = fabsf(
+							out[index] - e);
+						if (d > 1e-5f + fabsf(e) * 1e-5f)
+							break;
+					}
+					if (index < n * 4)
+						fail("f32 differs from scalar",
+						     paths[p].name, "", invert,
+						     linear, index / 4);
+					if (out[n * 4] != 0.0f)
+						fail("f32 wrote past the end",
+						     paths[p].name, "", invert,
+						     linear, n);
+
+					matte_composite_rgba8_path(
+						MATTE_COMPOSITE_SCALAR,
+						expected8, a8, b8, matte8, n,
+						invert, linear);
+					matte_composite_rgba8_path(
+						paths[p].path, out8, a8, b8,
+						matte8, n, invert, linear);
+					if (!compare_rgba8(out8, expected8,
+							   n * 4, &index))
+						fail("rgba8 differs from scalar",
+						     paths[p].name, "", invert,
+						     linear, index);
+				}
+			}
+		}
+		printf("%s matches scalar\n", paths[p].name);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <golden dir> [--update]\n",
+			argv[0]);
+		return 2;
+	}
+
+	const bool update = argc > 2 && strcmp(argv[2], "--update") == 0;
+	check_goldens(argv[1], update);
+	if (!update)
+		check_simd_against_scalar();
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	printf("all passed\n");
+	return 0;
+}
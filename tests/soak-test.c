@@ -0,0 +1,306 @@
+/*
+ * Soak test on the stub libobs: runs randomized update, start, render and
+ * stop cycles over many transition instances, then checks that every
+ * texrender, obs_data_t and browser reference the plugin took was given
+ * back.
+ *
+ *   soak-test [--instances N] [--cycles N] [--seed N] [--verbose]
+ */
+#include "obs-stub.h"
+#include <util/platform.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#define MATTE_SOURCE_NAME "Soak Matte"
+
+enum op {
+	OP_UPDATE,
+	OP_START,
+	OP_RENDER,
+	OP_STOP,
+	OP_PROPERTIES,
+	OP_STATS,
+	OP_RECREATE,
+	OP_COUNT,
+};
+
+static const char *op_names[OP_COUNT] = {
+	"update", "start", "render", "stop", "properties", "stats", "recreate",
+};
+
+struct instance {
+	obs_source_t *transition;
+	float time;
+	bool transitioning;
+};
+
+struct op_stats {
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+};
+
+static struct op_stats stats[OP_COUNT];
+static uint32_t random_state;
+static int failures;
+static int log_level = LOG_WARNING;
+
+static uint32_t random_range(uint32_t count)
+{
+	return test_random_range(&random_state, count);
+}
+
+static bool random_bool(void)
+{
+	return random_range(2);
+}
+
+static obs_source_t *create_transition(size_t index)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "Soak %zu", index);
+	obs_data_t *settings = obs_data_create();
+	stub_random_settings(&random_state, settings, MATTE_SOURCE_NAME);
+	obs_source_t *transition = stub_transition_create(name, settings);
+	obs_data_release(settings);
+	return transition;
+}
+
+static void render_frames(struct instance *inst)
+{
+	const uint32_t frames = 1 + random_range(4);
+	if (random_range(16) == 0)
+		stub_add_lagged_frames(1 + random_range(3));
+
+	for (uint32_t i = 0; i < frames; i++) {
+		if (inst->transitioning) {
+			inst->time += 0.05f + (float)random_range(10) / 100.0f;
+			stub_transition_set_time(inst->transition,
+						 inst->time > 1.0f ? 1.0f
+								   : inst->time);
+		}
+		stub_video_tick(1.0f / 60.0f);
+		stub_video_render(inst->transition);
+		stub_audio_render(inst->transition);
+	}
+}
+
+static void run_op(struct instance *inst, size_t index, enum op op)
+{
+	switch (op) {
+	case OP_UPDATE: {
+		obs_data_t *settings = obs_data_create();
+		stub_random_settings(&random_state, settings,
+				     MATTE_SOURCE_NAME);
+		if (random_range(8) == 0)
+			stub_transition_set_size(inst->transition,
+						 random_bool() ? 1280 : 1920,
+						 random_bool() ? 720 : 1080);
+		obs_source_update(inst->transition, settings);
+		obs_data_release(settings);
+		break;
+	}
+	case OP_START:
+		inst->time = 0.0f;
+		inst->transitioning = true;
+		stub_transition_start(inst->transition);
+		break;
+	case OP_RENDER:
+		render_frames(inst);
+		break;
+	case OP_STOP:
+		inst->transitioning = false;
+		stub_transition_stop(inst->transition);
+		break;
+	case OP_PROPERTIES:
+		obs_properties_destroy(
+			stub_transition_properties(inst->transition));
+		break;
+	case OP_STATS: {
+		calldata_t cd = {0};
+		const char *json = NULL;
+		proc_handler_call(obs_source_get_proc_handler(inst->transition),
+				  "get_render_stats", &cd);
+		if (!calldata_get_string(&cd, "json", &json) || !json ||
+		    *json != '{') {
+			printf("FAIL get_render_stats returned no json\n");
+			failures++;
+		}
+		calldata_free(&cd);
+		break;
+	}
+	case OP_RECREATE:
+		if (inst->transitioning)
+			stub_transition_stop(inst->transition);
+		obs_source_release(inst->transition);
+		/* the failure path has to give back what it already made */
+		if (random_range(4) == 0) {
+			stub_fail_next_effect();
+			stub_set_log_level(0);
+			if (create_transition(index)) {
+				printf("FAIL create succeeded without an effect\n");
+				failures++;
+			}
+			stub_set_log_level(log_level);
+		}
+		inst->transition = create_transition(index);
+		inst->transitioning = false;
+		break;
+	case OP_COUNT:
+		break;
+	}
+}
+
+static enum op pick_op(const struct instance *inst)
+{
+	/* mostly rendering, like a real session */
+	const uint32_t r = random_range(100);
+	if (r < 45)
+		return OP_RENDER;
+	if (r < 60)
+		return OP_UPDATE;
+	if (r < 72)
+		return OP_START;
+	if (r < 84)
+		return inst->transitioning ? OP_STOP : OP_RENDER;
+	if (r < 90)
+		return OP_PROPERTIES;
+	if (r < 96)
+		return OP_STATS;
+	return OP_RECREATE;
+}
+
+static void expect_zero(const char *what, long count)
+{
+	if (count) {
+		printf("FAIL leaked %ld %s\n", count, what);
+		failures++;
+	}
+}
+
+static long max_rss_kb(void)
+{
+	struct rusage usage;
+	return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+int main(int argc, char **argv)
+{
+	size_t instance_count = 8;
+	size_t cycles = 4000;
+	random_state = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+			instance_count = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+			cycles = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			random_state = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--verbose") == 0)
+			log_level = LOG_DEBUG;
+		else {
+			fprintf(stderr,
+				"usage: %s [--instances N] [--cycles N] [--seed N] [--verbose]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+	if (!instance_count)
+		instance_count = 1;
+	stub_set_log_level(log_level);
+
+	obs_module_load();
+	obs_source_t *matte = stub_source_create(
+		"ffmpeg_source", MATTE_SOURCE_NAME, 1920, 1080);
+
+	struct instance *instances = calloc(instance_count, sizeof(*instances));
+	for (size_t i = 0; i < instance_count; i++)
+		instances[i].transition = create_transition(i);
+	stub_reset_peak_memory();
+
+	const uint64_t begin = os_gettime_ns();
+	for (size_t cycle = 0; cycle < cycles; cycle++) {
+		const size_t index = random_range((uint32_t)instance_count);
+		struct instance *inst = &instances[index];
+		const enum op op = pick_op(inst);
+
+		if (random_range(32) == 0)
+			stub_set_child_audio(random_bool());
+
+		const uint64_t op_begin = os_gettime_ns();
+		run_op(inst, index, op);
+		const uint64_t ns = os_gettime_ns() - op_begin;
+		stats[op].count++;
+		stats[op].total_ns += ns;
+		if (ns > stats[op].max_ns)
+			stats[op].max_ns = ns;
+
+		if (!inst->transition) {
+			printf("FAIL transition %zu could not be created\n",
+			       index);
+			failures++;
+			break;
+		}
+	}
+	const uint64_t elapsed = os_gettime_ns() - begin;
+
+	struct stub_counts counts;
+	stub_get_counts(&counts);
+	printf("%zu instances, %zu cycles in %.1f ms\n", instance_count, cycles,
+	       (double)elapsed / 1e6);
+	for (int op = 0; op < OP_COUNT; op++) {
+		if (!stats[op].count)
+			continue;
+		printf("  %-10s %7llu ops  %9.1f us/op  max %9.1f us\n",
+		       op_names[op], (unsigned long long)stats[op].count,
+		       (double)stats[op].total_ns / (double)stats[op].count /
+			       1e3,
+		       (double)stats[op].max_ns / 1e3);
+	}
+	printf("peak plugin memory %.1f KiB, max rss %ld KiB\n",
+	       (double)counts.peak_memory / 1024.0, max_rss_kb());
+
+	/* nothing may stay active once every transition has stopped */
+	for (size_t i = 0; i < instance_count; i++)
+		if (instances[i].transition && instances[i].transitioning)
+			stub_transition_stop(instances[i].transition);
+	expect_zero("matte activations", stub_source_get_active_count(matte));
+	/* the user's own source must never be rewound by a transition */
+	const long restarts = stub_source_get_restart_count(matte);
+	if (restarts) {
+		printf("FAIL existing source restarted %ld times\n", restarts);
+		failures++;
+	}
+
+	for (size_t i = 0; i < instance_count; i++)
+		obs_source_release(instances[i].transition);
+	free(instances);
+	obs_source_release(matte);
+	obs_module_unload();
+	stub_remove_trace_files();
+
+	stub_get_counts(&counts);
+	expect_zero("sources", counts.sources);
+	expect_zero("weak source references", counts.weak_refs);
+	expect_zero("obs_data_t objects", counts.data);
+	expect_zero("properties", counts.properties);
+	expect_zero("texrenders", counts.texrenders);
+	expect_zero("stage surfaces", counts.stagesurfs);
+	expect_zero("effects", counts.effects);
+	expect_zero("gpu timers", counts.timers);
+	expect_zero("calldata stacks", counts.calldata);
+	expect_zero("bytes of plugin memory", counts.memory);
+	expect_zero("graphics calls outside the graphics context",
+		    counts.graphics_violations);
+
+	if (failures) {
+		printf("%d failures\n", failures);
+		return 1;
+	}
+	printf("no leaks\n");
+	return 0;
+}
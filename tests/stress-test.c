@@ -0,0 +1,201 @@
+/*
+ * Concurrency stress test on the stub libobs. A UI thread updates and
+ * starts the transitions with random settings while a graphics thread
+ * ticks and renders them and an audio thread mixes them, like OBS does.
+ * Built with ThreadSanitizer where the compiler supports it, which then
+ * reports the data races and fails the run.
+ *
+ *   stress-test [--instances N] [--seconds N] [--seed N]
+ */
+#include "obs-stub.h"
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MATTE_SOURCE_NAME "Stress Matte"
+
+struct instance {
+	obs_source_t *transition;
+	/* set by the UI thread on start, advanced and cleared by the
+	 * graphics thread, which also stops the transition */
+	volatile bool started;
+	float time;
+};
+
+struct thread_stats {
+	const char *name;
+	uint64_t ops;
+};
+
+static struct instance *instances;
+static size_t instance_count = 4;
+static uint32_t seed = 1;
+static volatile bool running = true;
+
+static void *ui_thread(void *param)
+{
+	struct thread_stats *stats = param;
+	uint32_t state = seed * 7919u;
+	while (os_atomic_load_bool(&running)) {
+		struct instance *inst = &instances[test_random_range(
+			&state, (uint32_t)instance_count)];
+		const uint32_t op = test_random_range(&state, 10);
+		if (op < 5) {
+			obs_data_t *settings = obs_data_create();
+			stub_random_settings(&state, settings,
+					     MATTE_SOURCE_NAME);
+			obs_source_update(inst->transition, settings);
+			obs_data_release(settings);
+		} else if (op < 8) {
+			stub_transition_set_time(inst->transition, 0.0f);
+			stub_transition_start(inst->transition);
+			os_atomic_set_bool(&inst->started, true);
+		} else if (op < 9) {
+			obs_properties_destroy(
+				stub_transition_properties(inst->transition));
+		} else {
+			calldata_t cd = {0};
+			proc_handler_call(
+				obs_source_get_proc_handler(inst->transition),
+				"get_render_stats", &cd);
+			calldata_free(&cd);
+		}
+		stats->ops++;
+	}
+	return NULL;
+}
+
+static void *graphics_thread(void *param)
+{
+	struct thread_stats *stats = param;
+	uint32_t state = seed + 12345u;
+	while (os_atomic_load_bool(&running)) {
+		if (test_random_range(&state, 64) == 0)
+			stub_add_lagged_frames(1);
+		stub_video_tick(1.0f / 60.0f);
+
+		for (size_t i = 0; i < instance_count; i++) {
+			struct instance *inst = &instances[i];
+			if (os_atomic_exchange_bool(&inst->started, false))
+				inst->time = 0.0f;
+			else if (inst->time < 1.0f)
+				inst->time += 0.02f;
+
+			stub_transition_set_time(inst->transition,
+						 inst->time < 1.0f ? inst->time
+								   : 1.0f);
+			stub_video_render(inst->transition);
+			/* obs_transition_tick stops it once the time is up */
+			if (inst->time >= 1.0f && inst->time < 1.01f) {
+				stub_transition_stop(inst->transition);
+				inst->time = 2.0f;
+			}
+		}
+		stats->ops++;
+	}
+	return NULL;
+}
+
+static void *audio_thread(void *param)
+{
+	struct thread_stats *stats = param;
+	uint32_t state = seed + 777u;
+	while (os_atomic_load_bool(&running)) {
+		if (test_random_range(&state, 32) == 0)
+			stub_set_child_audio(test_random_range(&state, 2));
+		for (size_t i = 0; i < instance_count; i++)
+			stub_audio_render(instances[i].transition);
+		stats->ops++;
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t seconds = 2;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+			instance_count = strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+			seconds = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else {
+			fprintf(stderr,
+				"usage: %s [--instances N] [--seconds N] [--seed N]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+	if (!instance_count)
+		instance_count = 1;
+
+	/* the conflicting trace files warn all the time */
+	stub_set_log_level(LOG_ERROR);
+	obs_module_load();
+	obs_source_t *matte = stub_source_create(
+		"ffmpeg_source", MATTE_SOURCE_NAME, 1920, 1080);
+	stub_set_child_audio(true);
+
+	instances = calloc(instance_count, sizeof(*instances));
+	for (size_t i = 0; i < instance_count; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "Stress %zu", i);
+		obs_data_t *settings = obs_data_create();
+		uint32_t state = seed + (uint32_t)i;
+		stub_random_settings(&state, settings, MATTE_SOURCE_NAME);
+		instances[i].transition = stub_transition_create(name, settings);
+		instances[i].time = 2.0f;
+		obs_data_release(settings);
+		if (!instances[i].transition) {
+			printf("FAIL could not create '%s'\n", name);
+			return 1;
+		}
+	}
+
+	struct thread_stats stats[3] = {
+		{"ui", 0},
+		{"graphics", 0},
+		{"audio", 0},
+	};
+	void *(*funcs[3])(void *) = {ui_thread, graphics_thread, audio_thread};
+	pthread_t threads[3];
+
+	const uint64_t begin = os_gettime_ns();
+	for (size_t i = 0; i < 3; i++)
+		pthread_create(&threads[i], NULL, funcs[i], &stats[i]);
+	os_sleep_ms(seconds * 1000);
+	os_atomic_set_bool(&running, false);
+	for (size_t i = 0; i < 3; i++)
+		pthread_join(threads[i], NULL);
+	const double elapsed = (double)(os_gettime_ns() - begin) / 1e9;
+
+	printf("%zu instances for %.2f s\n", instance_count, elapsed);
+	for (size_t i = 0; i < 3; i++)
+		printf("  %-8s %9llu ops  %10.0f ops/s\n", stats[i].name,
+		       (unsigned long long)stats[i].ops,
+		       (double)stats[i].ops / elapsed);
+
+	for (size_t i = 0; i < instance_count; i++) {
+		stub_transition_stop(instances[i].transition);
+		obs_source_release(instances[i].transition);
+	}
+	free(instances);
+	obs_source_release(matte);
+	obs_module_unload();
+	stub_remove_trace_files();
+
+	struct stub_counts counts;
+	stub_get_counts(&counts);
+	if (counts.graphics_violations) {
+		printf("FAIL %ld graphics calls outside the graphics context\n",
+		       counts.graphics_violations);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,495 @@
+#pragma once
+
+/*
+ * The part of the libobs API the plugin uses, declared the same way libobs
+ * does so the plugin sources build unchanged against obs-stub.c.
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/bmem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UNUSED_PARAMETER(param) (void)param
+#define EXPORT
+#define MODULE_EXPORT
+
+#define LOG_ERROR 100
+#define LOG_WARNING 200
+#define LOG_INFO 300
+#define LOG_DEBUG 400
+
+#define MAX_AUDIO_MIXES 6
+#define MAX_AUDIO_CHANNELS 8
+#define AUDIO_OUTPUT_FRAMES 1024
+
+#define OBS_DECLARE_MODULE()
+#define OBS_MODULE_AUTHOR(name)
+#define OBS_MODULE_USE_DEFAULT_LOCALE(module_name, default_locale)
+
+typedef struct obs_source obs_source_t;
+typedef struct obs_weak_source obs_weak_source_t;
+typedef struct obs_data obs_data_t;
+typedef struct obs_data_item obs_data_item_t;
+typedef struct obs_data_array obs_data_array_t;
+typedef struct obs_properties obs_properties_t;
+typedef struct obs_property obs_property_t;
+typedef struct gs_effect gs_effect_t;
+typedef struct gs_effect_param gs_eparam_t;
+typedef struct gs_texture gs_texture_t;
+typedef struct gs_texture_render gs_texrender_t;
+typedef struct gs_stage_surface gs_stagesurf_t;
+typedef struct gs_timer gs_timer_t;
+typedef struct gs_timer_range gs_timer_range_t;
+typedef struct proc_handler proc_handler_t;
+typedef struct video_output video_t;
+
+struct calldata {
+	uint8_t *stack;
+	size_t size;
+	size_t capacity;
+	bool fixed;
+};
+typedef struct calldata calldata_t;
+
+typedef void (*proc_handler_proc_t)(void *param, calldata_t *cd);
+
+struct vec4 {
+	float x, y, z, w;
+};
+
+struct audio_output_data {
+	float *data[MAX_AUDIO_CHANNELS];
+};
+
+struct obs_source_audio_mix {
+	struct audio_output_data output[MAX_AUDIO_MIXES];
+};
+
+enum gs_color_space {
+	GS_CS_SRGB,
+	GS_CS_SRGB_16F,
+	GS_CS_709_EXTENDED,
+	GS_CS_709_SCRGB,
+};
+
+enum gs_color_format {
+	GS_UNKNOWN,
+	GS_RGBA,
+	GS_BGRA,
+	GS_RGBA16F,
+};
+
+enum gs_zstencil_format {
+	GS_ZS_NONE,
+};
+
+enum gs_blend_type {
+	GS_BLEND_ZERO,
+	GS_BLEND_ONE,
+};
+
+#define GS_CLEAR_COLOR (1 << 0)
+
+enum obs_transition_target {
+	OBS_TRANSITION_SOURCE_A,
+	OBS_TRANSITION_SOURCE_B,
+};
+
+enum obs_monitoring_type {
+	OBS_MONITORING_TYPE_NONE,
+	OBS_MONITORING_TYPE_MONITOR_ONLY,
+	OBS_MONITORING_TYPE_MONITOR_AND_OUTPUT,
+};
+
+enum obs_source_type {
+	OBS_SOURCE_TYPE_INPUT,
+	OBS_SOURCE_TYPE_FILTER,
+	OBS_SOURCE_TYPE_TRANSITION,
+	OBS_SOURCE_TYPE_SCENE,
+};
+
+enum obs_combo_type {
+	OBS_COMBO_TYPE_INVALID,
+	OBS_COMBO_TYPE_EDITABLE,
+	OBS_COMBO_TYPE_LIST,
+};
+
+enum obs_combo_format {
+	OBS_COMBO_FORMAT_INVALID,
+	OBS_COMBO_FORMAT_INT,
+	OBS_COMBO_FORMAT_FLOAT,
+	OBS_COMBO_FORMAT_STRING,
+};
+
+enum obs_group_type {
+	OBS_COMBO_INVALID,
+	OBS_GROUP_NORMAL,
+	OBS_GROUP_CHECKABLE,
+};
+
+enum obs_text_type {
+	OBS_TEXT_DEFAULT,
+	OBS_TEXT_PASSWORD,
+	OBS_TEXT_MULTILINE,
+	OBS_TEXT_INFO,
+};
+
+enum obs_path_type {
+	OBS_PATH_FILE,
+	OBS_PATH_FILE_SAVE,
+	OBS_PATH_DIRECTORY,
+};
+
+enum obs_data_type {
+	OBS_DATA_NULL,
+	OBS_DATA_STRING,
+	OBS_DATA_NUMBER,
+	OBS_DATA_BOOLEAN,
+	OBS_DATA_OBJECT,
+	OBS_DATA_ARRAY,
+};
+
+enum obs_data_number_type {
+	OBS_DATA_NUM_INVALID,
+	OBS_DATA_NUM_INT,
+	OBS_DATA_NUM_DOUBLE,
+};
+
+enum obs_base_effect {
+	OBS_EFFECT_DEFAULT,
+};
+
+#define OBS_PROPERTIES_DEFER_UPDATE (1 << 0)
+
+#define OBS_SOURCE_VIDEO (1 << 0)
+#define OBS_SOURCE_AUDIO (1 << 1)
+
+struct obs_video_info {
+	uint32_t fps_num;
+	uint32_t fps_den;
+	uint32_t base_width;
+	uint32_t base_height;
+	uint32_t output_width;
+	uint32_t output_height;
+};
+
+struct obs_audio_info {
+	uint32_t samples_per_sec;
+	int speakers;
+};
+
+typedef float (*obs_transition_audio_mix_callback_t)(void *data, float t);
+typedef void (*obs_transition_video_render_callback_t)(void *data,
+							gs_texture_t *a,
+							gs_texture_t *b, float t,
+							uint32_t cx, uint32_t cy);
+typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
+				       obs_source_t *child, void *param);
+typedef bool (*obs_property_modified_t)(obs_properties_t *props,
+					obs_property_t *property,
+					obs_data_t *settings);
+typedef bool (*obs_property_modified2_t)(void *priv, obs_properties_t *props,
+					 obs_property_t *property,
+					 obs_data_t *settings);
+typedef bool (*obs_property_clicked_t)(obs_properties_t *props,
+				       obs_property_t *property, void *data);
+
+struct obs_source_info {
+	const char *id;
+	enum obs_source_type type;
+	uint32_t output_flags;
+	const char *(*get_name)(void *type_data);
+	void *(*create)(obs_data_t *settings, obs_source_t *source);
+	void (*destroy)(void *data);
+	void (*update)(void *data, obs_data_t *settings);
+	void (*video_render)(void *data, gs_effect_t *effect);
+	bool (*audio_render)(void *data, uint64_t *ts_out,
+			     struct obs_source_audio_mix *audio_output,
+			     uint32_t mixers, size_t channels,
+			     size_t sample_rate);
+	obs_properties_t *(*get_properties)(void *data);
+	void (*get_defaults)(obs_data_t *settings);
+	void (*transition_start)(void *data);
+	void (*transition_stop)(void *data);
+	void (*enum_active_sources)(void *data,
+				    obs_source_enum_proc_t enum_callback,
+				    void *param);
+	void (*enum_all_sources)(void *data,
+				 obs_source_enum_proc_t enum_callback,
+				 void *param);
+	void (*load)(void *data, obs_data_t *settings);
+	void (*video_tick)(void *data, float seconds);
+	enum gs_color_space (*video_get_color_space)(
+		void *data, size_t count,
+		const enum gs_color_space *preferred_spaces);
+	void (*show)(void *data);
+	void (*hide)(void *data);
+};
+
+/* module */
+void blog(int log_level, const char *format, ...);
+char *obs_module_file(const char *file);
+const char *obs_module_text(const char *lookup_string);
+void obs_register_source(struct obs_source_info *info);
+bool obs_module_load(void);
+void obs_module_unload(void);
+
+/* sources */
+obs_source_t *obs_source_create_private(const char *id, const char *name,
+					obs_data_t *settings);
+void obs_source_release(obs_source_t *source);
+obs_source_t *obs_source_get_ref(obs_source_t *source);
+obs_weak_source_t *obs_source_get_weak_source(obs_source_t *source);
+obs_source_t *obs_weak_source_get_source(obs_weak_source_t *weak);
+void obs_weak_source_release(obs_weak_source_t *weak);
+obs_source_t *obs_get_source_by_name(const char *name);
+void obs_enum_sources(bool (*enum_proc)(void *, obs_source_t *), void *param);
+const char *obs_source_get_name(const obs_source_t *source);
+const char *obs_source_get_id(const obs_source_t *source);
+uint32_t obs_source_get_output_flags(const obs_source_t *source);
+uint32_t obs_source_get_width(obs_source_t *source);
+uint32_t obs_source_get_height(obs_source_t *source);
+bool obs_source_active(const obs_source_t *source);
+bool obs_source_showing(const obs_source_t *source);
+void obs_source_update(obs_source_t *source, obs_data_t *settings);
+obs_data_t *obs_source_get_settings(const obs_source_t *source);
+void obs_source_video_render(obs_source_t *source);
+enum gs_color_space
+obs_source_get_color_space(obs_source_t *source, size_t count,
+			   const enum gs_color_space *preferred_spaces);
+void obs_source_set_monitoring_type(obs_source_t *source,
+				    enum obs_monitoring_type type);
+void obs_source_set_volume(obs_source_t *source, float volume);
+void obs_source_set_muted(obs_source_t *source, bool muted);
+bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child);
+void obs_source_remove_active_child(obs_source_t *parent,
+				    obs_source_t *child);
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source);
+bool obs_source_audio_pending(const obs_source_t *source);
+uint64_t obs_source_get_audio_timestamp(const obs_source_t *source);
+void obs_source_get_audio_mix(const obs_source_t *source,
+			      struct obs_source_audio_mix *audio);
+void obs_source_inc_showing(obs_source_t *source);
+void obs_source_dec_showing(obs_source_t *source);
+obs_properties_t *obs_source_properties(const obs_source_t *source);
+void obs_source_media_restart(obs_source_t *source);
+
+/* transitions */
+void obs_transition_enable_fixed(obs_source_t *transition, bool enable,
+				 uint32_t duration_ms);
+float obs_transition_get_time(obs_source_t *transition);
+bool obs_transition_video_render(obs_source_t *transition,
+				 obs_transition_video_render_callback_t callback);
+bool obs_transition_video_render_direct(obs_source_t *transition,
+					enum obs_transition_target target);
+bool obs_transition_audio_render(obs_source_t *transition, uint64_t *ts_out,
+				 struct obs_source_audio_mix *audio,
+				 uint32_t mixers, size_t channels,
+				 size_t sample_rate,
+				 obs_transition_audio_mix_callback_t mix_a_callback,
+				 obs_transition_audio_mix_callback_t mix_b_callback);
+obs_source_t *obs_transition_get_active_source(obs_source_t *transition);
+obs_source_t *obs_transition_get_source(obs_source_t *transition,
+					enum obs_transition_target target);
+enum gs_color_space obs_transition_video_get_color_space(obs_source_t *source);
+
+/* core */
+float obs_db_to_mul(float db);
+float obs_get_video_sdr_white_level(void);
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect);
+obs_data_t *obs_get_source_defaults(const char *id);
+bool obs_get_video_info(struct obs_video_info *ovi);
+bool obs_get_audio_info(struct obs_audio_info *oai);
+uint32_t obs_get_lagged_frames(void);
+video_t *obs_get_video(void);
+uint32_t video_output_get_skipped_frames(const video_t *video);
+void obs_enter_graphics(void);
+void obs_leave_graphics(void);
+
+/* data */
+obs_data_t *obs_data_create(void);
+void obs_data_addref(obs_data_t *data);
+void obs_data_release(obs_data_t *data);
+const char *obs_data_get_json(obs_data_t *data);
+double obs_data_get_double(obs_data_t *data, const char *name);
+long long obs_data_get_int(obs_data_t *data, const char *name);
+bool obs_data_get_bool(obs_data_t *data, const char *name);
+const char *obs_data_get_string(obs_data_t *data, const char *name);
+obs_data_t *obs_data_get_obj(obs_data_t *data, const char *name);
+void obs_data_set_double(obs_data_t *data, const char *name, double val);
+void obs_data_set_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val);
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val);
+void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj);
+void obs_data_set_default_double(obs_data_t *data, const char *name,
+				 double val);
+void obs_data_set_default_int(obs_data_t *data, const char *name,
+			      long long val);
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val);
+void obs_data_set_default_string(obs_data_t *data, const char *name,
+				 const char *val);
+void obs_data_set_default_obj(obs_data_t *data, const char *name,
+			      obs_data_t *obj);
+void obs_data_set_default_array(obs_data_t *data, const char *name,
+				obs_data_array_t *array);
+void obs_data_array_release(obs_data_array_t *array);
+obs_data_item_t *obs_data_first(obs_data_t *data);
+bool obs_data_item_next(obs_data_item_t **item);
+enum obs_data_type obs_data_item_gettype(obs_data_item_t *item);
+enum obs_data_number_type obs_data_item_numtype(obs_data_item_t *item);
+const char *obs_data_item_get_name(obs_data_item_t *item);
+const char *obs_data_item_get_default_string(obs_data_item_t *item);
+long long obs_data_item_get_default_int(obs_data_item_t *item);
+double obs_data_item_get_default_double(obs_data_item_t *item);
+bool obs_data_item_get_default_bool(obs_data_item_t *item);
+obs_data_t *obs_data_item_get_default_obj(obs_data_item_t *item);
+obs_data_array_t *obs_data_item_get_default_array(obs_data_item_t *item);
+
+/* properties */
+obs_properties_t *obs_properties_create(void);
+void obs_properties_destroy(obs_properties_t *props);
+void obs_properties_set_flags(obs_properties_t *props, uint32_t flags);
+obs_property_t *obs_properties_get(obs_properties_t *props, const char *name);
+void obs_properties_remove_by_name(obs_properties_t *props, const char *name);
+obs_property_t *obs_properties_add_float(obs_properties_t *props,
+					 const char *name, const char *desc,
+					 double min, double max, double step);
+obs_property_t *obs_properties_add_float_slider(obs_properties_t *props,
+						const char *name,
+						const char *desc, double min,
+						double max, double step);
+obs_property_t *obs_properties_add_int(obs_properties_t *props,
+				       const char *name, const char *desc,
+				       int min, int max, int step);
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props,
+					      const char *name,
+					      const char *desc, int min,
+					      int max, int step);
+obs_property_t *obs_properties_add_bool(obs_properties_t *props,
+					const char *name, const char *desc);
+obs_property_t *obs_properties_add_list(obs_properties_t *props,
+					const char *name, const char *desc,
+					enum obs_combo_type type,
+					enum obs_combo_format format);
+obs_property_t *obs_properties_add_group(obs_properties_t *props,
+					 const char *name, const char *desc,
+					 enum obs_group_type type,
+					 obs_properties_t *group);
+obs_property_t *obs_properties_add_text(obs_properties_t *props,
+					const char *name, const char *desc,
+					enum obs_text_type type);
+obs_property_t *obs_properties_add_path(obs_properties_t *props,
+					const char *name, const char *desc,
+					enum obs_path_type type,
+					const char *filter,
+					const char *default_path);
+obs_property_t *obs_properties_add_button2(obs_properties_t *props,
+					   const char *name, const char *text,
+					   obs_property_clicked_t callback,
+					   void *priv);
+void obs_property_float_set_suffix(obs_property_t *p, const char *suffix);
+void obs_property_int_set_suffix(obs_property_t *p, const char *suffix);
+size_t obs_property_list_add_int(obs_property_t *p, const char *name,
+				 long long val);
+size_t obs_property_list_add_string(obs_property_t *p, const char *name,
+				    const char *val);
+void obs_property_set_modified_callback(obs_property_t *p,
+					obs_property_modified_t modified);
+void obs_property_set_modified_callback2(obs_property_t *p,
+					 obs_property_modified2_t modified,
+					 void *priv);
+void obs_property_set_visible(obs_property_t *p, bool visible);
+void obs_property_set_description(obs_property_t *p,
+				  const char *description);
+bool obs_property_button_clicked(obs_property_t *p, void *obj);
+
+/* calldata and procedures */
+void calldata_set_string(calldata_t *data, const char *name, const char *str);
+bool calldata_get_string(const calldata_t *data, const char *name,
+			 const char **str);
+void calldata_free(calldata_t *data);
+void proc_handler_add(proc_handler_t *handler, const char *decl_string,
+		      proc_handler_proc_t proc, void *data);
+bool proc_handler_call(proc_handler_t *handler, const char *name,
+		       calldata_t *params);
+
+/* graphics */
+gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string);
+void gs_effect_destroy(gs_effect_t *effect);
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect,
+					 const char *name);
+void gs_effect_set_texture(gs_eparam_t *param, gs_texture_t *val);
+void gs_effect_set_texture_srgb(gs_eparam_t *param, gs_texture_t *val);
+void gs_effect_set_bool(gs_eparam_t *param, bool val);
+void gs_effect_set_float(gs_eparam_t *param, float val);
+bool gs_effect_loop(gs_effect_t *effect, const char *name);
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
+		    uint32_t height);
+gs_texrender_t *gs_texrender_create(enum gs_color_format format,
+				    enum gs_zstencil_format zsformat);
+void gs_texrender_destroy(gs_texrender_t *texrender);
+bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx, uint32_t cy);
+bool gs_texrender_begin_with_color_space(gs_texrender_t *texrender,
+					 uint32_t cx, uint32_t cy,
+					 enum gs_color_space space);
+void gs_texrender_end(gs_texrender_t *texrender);
+void gs_texrender_reset(gs_texrender_t *texrender);
+gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
+enum gs_color_format gs_texrender_get_format(const gs_texrender_t *texrender);
+uint32_t gs_texture_get_width(const gs_texture_t *tex);
+uint32_t gs_texture_get_height(const gs_texture_t *tex);
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex);
+uint32_t gs_get_format_bpp(enum gs_color_format format);
+enum gs_color_format gs_get_format_from_space(enum gs_color_space space);
+enum gs_color_space gs_get_color_space(void);
+gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height,
+				       enum gs_color_format color_format);
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf);
+void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src);
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			 uint32_t *linesize);
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf);
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf);
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf);
+gs_timer_t *gs_timer_create(void);
+void gs_timer_destroy(gs_timer_t *timer);
+void gs_timer_begin(gs_timer_t *timer);
+void gs_timer_end(gs_timer_t *timer);
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks);
+gs_timer_range_t *gs_timer_range_create(void);
+void gs_timer_range_destroy(gs_timer_range_t *range);
+void gs_timer_range_begin(gs_timer_range_t *range);
+void gs_timer_range_end(gs_timer_range_t *range);
+bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
+			     uint64_t *frequency);
+bool gs_framebuffer_srgb_enabled(void);
+void gs_enable_framebuffer_srgb(bool enable);
+bool gs_set_linear_srgb(bool linear_srgb);
+void gs_matrix_push(void);
+void gs_matrix_pop(void);
+void gs_matrix_scale3f(float x, float y, float z);
+void gs_matrix_translate3f(float x, float y, float z);
+void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth,
+	      uint8_t stencil);
+void gs_ortho(float left, float right, float top, float bottom, float znear,
+	      float zfar);
+void gs_blend_state_push(void);
+void gs_blend_state_pop(void);
+void gs_enable_blending(bool enable);
+
+static inline void vec4_zero(struct vec4 *v)
+{
+	v->x = v->y = v->z = v->w = 0.0f;
+}
+
+#ifdef __cplusplus
+}
+#endif
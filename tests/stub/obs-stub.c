@@ -0,0 +1,2398 @@
+#include "obs-stub.h"
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ------------------------------------------------------------------------- */
+/* counters                                                                  */
+
+static volatile long live_sources;
+static volatile long live_weak_refs;
+static volatile long live_data;
+static volatile long live_properties;
+static volatile long live_texrenders;
+static volatile long live_stagesurfs;
+static volatile long live_effects;
+static volatile long live_timers;
+static volatile long live_calldata;
+static volatile long memory;
+static volatile long peak_memory;
+static volatile long graphics_violations;
+static volatile long errors;
+
+static volatile long log_level = LOG_WARNING;
+static volatile long timer_ns = 100000;
+static volatile bool fail_next_effect;
+static volatile bool child_audio;
+static volatile long lagged_frames;
+static volatile long paint_interval = 1;
+static volatile long stalled_paints;
+static volatile long ticks;
+
+void stub_get_counts(struct stub_counts *counts)
+{
+	counts->sources = os_atomic_load_long(&live_sources);
+	counts->weak_refs = os_atomic_load_long(&live_weak_refs);
+	counts->data = os_atomic_load_long(&live_data);
+	counts->properties = os_atomic_load_long(&live_properties);
+	counts->texrenders = os_atomic_load_long(&live_texrenders);
+	counts->stagesurfs = os_atomic_load_long(&live_stagesurfs);
+	counts->effects = os_atomic_load_long(&live_effects);
+	counts->timers = os_atomic_load_long(&live_timers);
+	counts->calldata = os_atomic_load_long(&live_calldata);
+	counts->memory = os_atomic_load_long(&memory);
+	counts->peak_memory = os_atomic_load_long(&peak_memory);
+	counts->graphics_violations =
+		os_atomic_load_long(&graphics_violations);
+	counts->errors = os_atomic_load_long(&errors);
+}
+
+void stub_reset_peak_memory(void)
+{
+	os_atomic_set_long(&peak_memory, os_atomic_load_long(&memory));
+}
+
+void stub_set_log_level(int level)
+{
+	os_atomic_set_long(&log_level, level);
+}
+
+void stub_fail_next_effect(void)
+{
+	os_atomic_set_bool(&fail_next_effect, true);
+}
+
+void stub_set_child_audio(bool enabled)
+{
+	os_atomic_set_bool(&child_audio, enabled);
+}
+
+void stub_set_timer_ns(uint32_t ns)
+{
+	os_atomic_set_long(&timer_ns, (long)ns);
+}
+
+void stub_set_paint_interval(uint32_t frames)
+{
+	os_atomic_set_long(&paint_interval, frames ? (long)frames : 1);
+}
+
+void stub_stall_paints(uint32_t frames)
+{
+	os_atomic_set_long(&stalled_paints, (long)frames);
+}
+
+void stub_add_lagged_frames(uint32_t frames)
+{
+	__atomic_add_fetch(&lagged_frames, (long)frames, __ATOMIC_SEQ_CST);
+}
+
+void blog(int level, const char *format, ...)
+{
+	if (level <= LOG_ERROR)
+		os_atomic_inc_long(&errors);
+	if (level > os_atomic_load_long(&log_level))
+		return;
+
+	char line[1024];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	fprintf(stderr, "%s\n", line);
+}
+
+/* ------------------------------------------------------------------------- */
+/* memory, with a size header so the live and peak bytes can be counted      */
+
+#define ALLOC_HEADER 16
+
+void *bmalloc(size_t size)
+{
+	uint8_t *ptr = malloc(size + ALLOC_HEADER);
+	if (!ptr)
+		abort();
+	memcpy(ptr, &size, sizeof(size));
+
+	const long now = __atomic_add_fetch(&memory, (long)size,
+					    __ATOMIC_SEQ_CST);
+	long peak = os_atomic_load_long(&peak_memory);
+	while (now > peak &&
+	       !os_atomic_compare_swap_long(&peak_memory, peak, now))
+		peak = os_atomic_load_long(&peak_memory);
+	return ptr + ALLOC_HEADER;
+}
+
+void *bzalloc(size_t size)
+{
+	void *ptr = bmalloc(size);
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+void bfree(void *ptr)
+{
+	if (!ptr)
+		return;
+	uint8_t *base = (uint8_t *)ptr - ALLOC_HEADER;
+	size_t size;
+	memcpy(&size, base, sizeof(size));
+	__atomic_sub_fetch(&memory, (long)size, __ATOMIC_SEQ_CST);
+	free(base);
+}
+
+void *brealloc(void *ptr, size_t size)
+{
+	if (!ptr)
+		return bmalloc(size);
+	size_t old_size;
+	memcpy(&old_size, (uint8_t *)ptr - ALLOC_HEADER, sizeof(old_size));
+	void *new_ptr = bmalloc(size);
+	memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+	bfree(ptr);
+	return new_ptr;
+}
+
+char *bstrdup(const char *str)
+{
+	if (!str)
+		return NULL;
+	const size_t len = strlen(str);
+	char *dup = bmalloc(len + 1);
+	memcpy(dup, str, len + 1);
+	return dup;
+}
+
+/* stub internals use plain malloc so they don't show up as plugin memory */
+static char *stub_strdup(const char *str)
+{
+	return str ? strdup(str) : NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* platform                                                                  */
+
+FILE *os_fopen(const char *path, const char *mode)
+{
+	return fopen(path, mode);
+}
+
+uint64_t os_gettime_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void os_sleep_ms(uint32_t duration)
+{
+	struct timespec ts = {duration / 1000,
+			      (long)(duration % 1000) * 1000000L};
+	nanosleep(&ts, NULL);
+}
+
+struct os_event_data {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool signalled;
+	bool manual;
+};
+
+int os_event_init(os_event_t **event, enum os_event_type type)
+{
+	struct os_event_data *data = calloc(1, sizeof(*data));
+	pthread_mutex_init(&data->mutex, NULL);
+	pthread_cond_init(&data->cond, NULL);
+	data->manual = type == OS_EVENT_TYPE_MANUAL;
+	*event = data;
+	return 0;
+}
+
+void os_event_destroy(os_event_t *event)
+{
+	if (!event)
+		return;
+	pthread_mutex_destroy(&event->mutex);
+	pthread_cond_destroy(&event->cond);
+	free(event);
+}
+
+int os_event_wait(os_event_t *event)
+{
+	pthread_mutex_lock(&event->mutex);
+	while (!event->signalled)
+		pthread_cond_wait(&event->cond, &event->mutex);
+	if (!event->manual)
+		event->signalled = false;
+	pthread_mutex_unlock(&event->mutex);
+	return 0;
+}
+
+int os_event_timedwait(os_event_t *event, unsigned long milliseconds)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += (time_t)(milliseconds / 1000);
+	ts.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	int code = 0;
+	pthread_mutex_lock(&event->mutex);
+	while (!event->signalled && code != ETIMEDOUT)
+		code = pthread_cond_timedwait(&event->cond, &event->mutex, &ts);
+	if (event->signalled) {
+		code = 0;
+		if (!event->manual)
+			event->signalled = false;
+	}
+	pthread_mutex_unlock(&event->mutex);
+	return code;
+}
+
+int os_event_try(os_event_t *event)
+{
+	int code = EAGAIN;
+	pthread_mutex_lock(&event->mutex);
+	if (event->signalled) {
+		code = 0;
+		if (!event->manual)
+			event->signalled = false;
+	}
+	pthread_mutex_unlock(&event->mutex);
+	return code;
+}
+
+int os_event_signal(os_event_t *event)
+{
+	pthread_mutex_lock(&event->mutex);
+	event->signalled = true;
+	pthread_cond_broadcast(&event->cond);
+	pthread_mutex_unlock(&event->mutex);
+	return 0;
+}
+
+void os_set_thread_name(const char *name)
+{
+	UNUSED_PARAMETER(name);
+}
+
+/* ------------------------------------------------------------------------- */
+/* data                                                                      */
+
+struct data_value {
+	long long i;
+	double d;
+	bool b;
+	char *s;
+	obs_data_t *obj;
+};
+
+struct obs_data_item {
+	struct obs_data_item *next;
+	char *name;
+	enum obs_data_type type;
+	enum obs_data_number_type numtype;
+	bool has_value;
+	bool has_default;
+	struct data_value value;
+	struct data_value def;
+};
+
+struct obs_data {
+	volatile long refs;
+	struct obs_data_item *first;
+	struct obs_data_item *last;
+	char *json;
+};
+
+/* obs_data isn't thread safe in libobs either, this only keeps the stub's
+ * own bookkeeping consistent */
+static pthread_mutex_t data_mutex;
+static pthread_once_t data_once = PTHREAD_ONCE_INIT;
+
+static void data_mutex_init(void)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&data_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+static void data_lock(void)
+{
+	pthread_once(&data_once, data_mutex_init);
+	pthread_mutex_lock(&data_mutex);
+}
+
+static void data_unlock(void)
+{
+	pthread_mutex_unlock(&data_mutex);
+}
+
+static void value_free(struct data_value *value)
+{
+	free(value->s);
+	obs_data_release(value->obj);
+	memset(value, 0, sizeof(*value));
+}
+
+obs_data_t *obs_data_create(void)
+{
+	obs_data_t *data = calloc(1, sizeof(*data));
+	data->refs = 1;
+	os_atomic_inc_long(&live_data);
+	return data;
+}
+
+void obs_data_addref(obs_data_t *data)
+{
+	if (data)
+		os_atomic_inc_long(&data->refs);
+}
+
+void obs_data_release(obs_data_t *data)
+{
+	if (!data || os_atomic_dec_long(&data->refs) > 0)
+		return;
+
+	data_lock();
+	struct obs_data_item *item = data->first;
+	while (item) {
+		struct obs_data_item *next = item->next;
+		value_free(&item->value);
+		value_free(&item->def);
+		free(item->name);
+		free(item);
+		item = next;
+	}
+	data_unlock();
+
+	free(data->json);
+	free(data);
+	os_atomic_dec_long(&live_data);
+}
+
+static struct obs_data_item *find_item(obs_data_t *data, const char *name)
+{
+	for (struct obs_data_item *item = data->first; item; item = item->next)
+		if (strcmp(item->name, name) == 0)
+			return item;
+	return NULL;
+}
+
+static struct obs_data_item *get_item(obs_data_t *data, const char *name,
+				      enum obs_data_type type)
+{
+	struct obs_data_item *item = find_item(data, name);
+	if (!item) {
+		item = calloc(1, sizeof(*item));
+		item->name = stub_strdup(name);
+		if (data->last)
+			data->last->next = item;
+		else
+			data->first = item;
+		data->last = item;
+	}
+	item->type = type;
+	return item;
+}
+
+static void set_value(obs_data_t *data, const char *name,
+		      enum obs_data_type type, enum obs_data_number_type numtype,
+		      const struct data_value *value, bool def)
+{
+	if (!data || !name)
+		return;
+	data_lock();
+	struct obs_data_item *item = get_item(data, name, type);
+	item->numtype = numtype;
+	struct data_value *dst = def ? &item->def : &item->value;
+	value_free(dst);
+	*dst = *value;
+	dst->s = stub_strdup(value->s);
+	obs_data_addref(value->obj);
+	if (def)
+		item->has_default = true;
+	else
+		item->has_value = true;
+	data_unlock();
+}
+
+static bool get_value(obs_data_t *data, const char *name,
+		      struct data_value *value,
+		      enum obs_data_number_type *numtype)
+{
+	memset(value, 0, sizeof(*value));
+	if (!data || !name)
+		return false;
+	data_lock();
+	struct obs_data_item *item = find_item(data, name);
+	const bool found = item && (item->has_value || item->has_default);
+	if (found) {
+		*value = item->has_value ? item->value : item->def;
+		if (numtype)
+			*numtype = item->numtype;
+	}
+	data_unlock();
+	return found;
+}
+
+double obs_data_get_double(obs_data_t *data, const char *name)
+{
+	struct data_value value;
+	enum obs_data_number_type numtype = OBS_DATA_NUM_INVALID;
+	get_value(data, name, &value, &numtype);
+	return numtype == OBS_DATA_NUM_INT ? (double)value.i : value.d;
+}
+
+long long obs_data_get_int(obs_data_t *data, const char *name)
+{
+	struct data_value value;
+	enum obs_data_number_type numtype = OBS_DATA_NUM_INVALID;
+	get_value(data, name, &value, &numtype);
+	return numtype == OBS_DATA_NUM_DOUBLE ? (long long)value.d : value.i;
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name)
+{
+	struct data_value value;
+	get_value(data, name, &value, NULL);
+	return value.b;
+}
+
+const char *obs_data_get_string(obs_data_t *data, const char *name)
+{
+	struct data_value value;
+	get_value(data, name, &value, NULL);
+	return value.s ? value.s : "";
+}
+
+obs_data_t *obs_data_get_obj(obs_data_t *data, const char *name)
+{
+	struct data_value value;
+	data_lock();
+	get_value(data, name, &value, NULL);
+	obs_data_addref(value.obj);
+	data_unlock();
+	return value.obj;
+}
+
+void obs_data_set_double(obs_data_t *data, const char *name, double val)
+{
+	struct data_value value = {.d = val};
+	set_value(data, name, OBS_DATA_NUMBER, OBS_DATA_NUM_DOUBLE, &value,
+		  false);
+}
+
+void obs_data_set_int(obs_data_t *data, const char *name, long long val)
+{
+	struct data_value value = {.i = val};
+	set_value(data, name, OBS_DATA_NUMBER, OBS_DATA_NUM_INT, &value, false);
+}
+
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val)
+{
+	struct data_value value = {.b = val};
+	set_value(data, name, OBS_DATA_BOOLEAN, OBS_DATA_NUM_INVALID, &value,
+		  false);
+}
+
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val)
+{
+	struct data_value value = {.s = (char *)(val ? val : "")};
+	set_value(data, name, OBS_DATA_STRING, OBS_DATA_NUM_INVALID, &value,
+		  false);
+}
+
+void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj)
+{
+	struct data_value value = {.obj = obj};
+	set_value(data, name, OBS_DATA_OBJECT, OBS_DATA_NUM_INVALID, &value,
+		  false);
+}
+
+void obs_data_set_default_double(obs_data_t *data, const char *name,
+				 double val)
+{
+	struct data_value value = {.d = val};
+	set_value(data, name, OBS_DATA_NUMBER, OBS_DATA_NUM_DOUBLE, &value,
+		  true);
+}
+
+void obs_data_set_default_int(obs_data_t *data, const char *name,
+			      long long val)
+{
+	struct data_value value = {.i = val};
+	set_value(data, name, OBS_DATA_NUMBER, OBS_DATA_NUM_INT, &value, true);
+}
+
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val)
+{
+	struct data_value value = {.b = val};
+	set_value(data, name, OBS_DATA_BOOLEAN, OBS_DATA_NUM_INVALID, &value,
+		  true);
+}
+
+void obs_data_set_default_string(obs_data_t *data, const char *name,
+				 const char *val)
+{
+	struct data_value value = {.s = (char *)(val ? val : "")};
+	set_value(data, name, OBS_DATA_STRING, OBS_DATA_NUM_INVALID, &value,
+		  true);
+}
+
+void obs_data_set_default_obj(obs_data_t *data, const char *name,
+			      obs_data_t *obj)
+{
+	struct data_value value = {.obj = obj};
+	set_value(data, name, OBS_DATA_OBJECT, OBS_DATA_NUM_INVALID, &value,
+		  true);
+}
+
+void obs_data_set_default_array(obs_data_t *data, const char *name,
+				obs_data_array_t *array)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(name);
+	UNUSED_PARAMETER(array);
+}
+
+void obs_data_array_release(obs_data_array_t *array)
+{
+	UNUSED_PARAMETER(array);
+}
+
+/* copies the user values, like obs_data_apply */
+static void data_apply(obs_data_t *dst, obs_data_t *src)
+{
+	if (!dst || !src || dst == src)
+		return;
+	data_lock();
+	for (struct obs_data_item *item = src->first; item; item = item->next)
+		if (item->has_value)
+			set_value(dst, item->name, item->type, item->numtype,
+				  &item->value, false);
+	data_unlock();
+}
+
+struct text {
+	char *str;
+	size_t len;
+	size_t capacity;
+};
+
+static void text_add(struct text *text, const char *str)
+{
+	const size_t len = strlen(str);
+	if (text->len + len + 1 > text->capacity) {
+		text->capacity = (text->len + len + 1) * 2;
+		text->str = realloc(text->str, text->capacity);
+	}
+	memcpy(text->str + text->len, str, len + 1);
+	text->len += len;
+}
+
+static void write_json(struct text *text, obs_data_t *data)
+{
+	char number[64];
+	bool first = true;
+	text_add(text, "{");
+	for (struct obs_data_item *item = data->first; item;
+	     item = item->next) {
+		if (!item->has_value)
+			continue;
+		text_add(text, first ? "\"" : ",\"");
+		text_add(text, item->name);
+		text_add(text, "\":");
+		first = false;
+
+		switch (item->type) {
+		case OBS_DATA_STRING:
+			text_add(text, "\"");
+			for (const char *c = item->value.s; c && *c; c++) {
+				const char ch[3] = {'\\', *c, 0};
+				text_add(text, (*c == '"' || *c == '\\')
+						       ? ch
+						       : ch + 1);
+			}
+			text_add(text, "\"");
+			break;
+		case OBS_DATA_NUMBER:
+			if (item->numtype == OBS_DATA_NUM_INT)
+				snprintf(number, sizeof(number), "%lld",
+					 item->value.i);
+			else
+				snprintf(number, sizeof(number), "%g",
+					 item->value.d);
+			text_add(text, number);
+			break;
+		case OBS_DATA_BOOLEAN:
+			text_add(text, item->value.b ? "true" : "false");
+			break;
+		case OBS_DATA_OBJECT:
+			if (item->value.obj)
+				write_json(text, item->value.obj);
+			else
+				text_add(text, "null");
+			break;
+		default:
+			text_add(text, "null");
+			break;
+		}
+	}
+	text_add(text, "}");
+}
+
+const char *obs_data_get_json(obs_data_t *data)
+{
+	if (!data)
+		return NULL;
+	struct text text = {0};
+	data_lock();
+	write_json(&text, data);
+	free(data->json);
+	data->json = text.str;
+	data_unlock();
+	return data->json;
+}
+
+obs_data_item_t *obs_data_first(obs_data_t *data)
+{
+	return data ? data->first : NULL;
+}
+
+bool obs_data_item_next(obs_data_item_t **item)
+{
+	if (!item || !*item)
+		return false;
+	*item = (*item)->next;
+	return *item != NULL;
+}
+
+enum obs_data_type obs_data_item_gettype(obs_data_item_t *item)
+{
+	return item ? item->type : OBS_DATA_NULL;
+}
+
+enum obs_data_number_type obs_data_item_numtype(obs_data_item_t *item)
+{
+	return item ? item->numtype : OBS_DATA_NUM_INVALID;
+}
+
+const char *obs_data_item_get_name(obs_data_item_t *item)
+{
+	return item ? item->name : NULL;
+}
+
+const char *obs_data_item_get_default_string(obs_data_item_t *item)
+{
+	return item && item->def.s ? item->def.s : "";
+}
+
+long long obs_data_item_get_default_int(obs_data_item_t *item)
+{
+	return item ? item->def.i : 0;
+}
+
+double obs_data_item_get_default_double(obs_data_item_t *item)
+{
+	return item ? item->def.d : 0.0;
+}
+
+bool obs_data_item_get_default_bool(obs_data_item_t *item)
+{
+	return item ? item->def.b : false;
+}
+
+obs_data_t *obs_data_item_get_default_obj(obs_data_item_t *item)
+{
+	if (!item)
+		return NULL;
+	obs_data_addref(item->def.obj);
+	return item->def.obj;
+}
+
+obs_data_array_t *obs_data_item_get_default_array(obs_data_item_t *item)
+{
+	UNUSED_PARAMETER(item);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* calldata and procedures                                                   */
+
+/* the stack holds "name\0value\0" pairs */
+static const char *calldata_find(const calldata_t *data, const char *name,
+				 size_t *entry, size_t *entry_size)
+{
+	size_t pos = 0;
+	while (pos < data->size) {
+		const char *key = (const char *)data->stack + pos;
+		const char *value = key + strlen(key) + 1;
+		const size_t size = (size_t)(value - key) + strlen(value) + 1;
+		if (strcmp(key, name) == 0) {
+			*entry = pos;
+			*entry_size = size;
+			return value;
+		}
+		pos += size;
+	}
+	return NULL;
+}
+
+void calldata_set_string(calldata_t *data, const char *name, const char *str)
+{
+	size_t entry, entry_size;
+	if (!str)
+		str = "";
+	if (calldata_find(data, name, &entry, &entry_size)) {
+		memmove(data->stack + entry, data->stack + entry + entry_size,
+			data->size - entry - entry_size);
+		data->size -= entry_size;
+	}
+
+	const size_t name_size = strlen(name) + 1;
+	const size_t str_size = strlen(str) + 1;
+	if (data->size + name_size + str_size > data->capacity) {
+		if (!data->stack)
+			os_atomic_inc_long(&live_calldata);
+		data->capacity = (data->size + name_size + str_size) * 2;
+		data->stack = brealloc(data->stack, data->capacity);
+	}
+	memcpy(data->stack + data->size, name, name_size);
+	memcpy(data->stack + data->size + name_size, str, str_size);
+	data->size += name_size + str_size;
+}
+
+bool calldata_get_string(const calldata_t *data, const char *name,
+			 const char **str)
+{
+	size_t entry, entry_size;
+	*str = calldata_find(data, name, &entry, &entry_size);
+	return *str != NULL;
+}
+
+void calldata_free(calldata_t *data)
+{
+	if (data->stack)
+		os_atomic_dec_long(&live_calldata);
+	bfree(data->stack);
+	memset(data, 0, sizeof(*data));
+}
+
+struct proc_entry {
+	struct proc_entry *next;
+	char *name;
+	proc_handler_proc_t proc;
+	void *data;
+};
+
+struct proc_handler {
+	pthread_mutex_t mutex;
+	struct proc_entry *first;
+};
+
+static proc_handler_t *proc_handler_create(void)
+{
+	proc_handler_t *handler = calloc(1, sizeof(*handler));
+	pthread_mutex_init(&handler->mutex, NULL);
+	return handler;
+}
+
+static void proc_handler_destroy(proc_handler_t *handler)
+{
+	struct proc_entry *entry = handler->first;
+	while (entry) {
+		struct proc_entry *next = entry->next;
+		free(entry->name);
+		free(entry);
+		entry = next;
+	}
+	pthread_mutex_destroy(&handler->mutex);
+	free(handler);
+}
+
+void proc_handler_add(proc_handler_t *handler, const char *decl_string,
+		      proc_handler_proc_t proc, void *data)
+{
+	/* "void name(...)" */
+	const char *start = strchr(decl_string, ' ');
+	const char *end = strchr(decl_string, '(');
+	if (!handler || !start || !end || end < start)
+		return;
+	start++;
+
+	struct proc_entry *entry = calloc(1, sizeof(*entry));
+	entry->name = strndup(start, (size_t)(end - start));
+	entry->proc = proc;
+	entry->data = data;
+	pthread_mutex_lock(&handler->mutex);
+	entry->next = handler->first;
+	handler->first = entry;
+	pthread_mutex_unlock(&handler->mutex);
+}
+
+bool proc_handler_call(proc_handler_t *handler, const char *name,
+		       calldata_t *params)
+{
+	if (!handler)
+		return false;
+	proc_handler_proc_t proc = NULL;
+	void *data = NULL;
+	pthread_mutex_lock(&handler->mutex);
+	for (struct proc_entry *e = handler->first; e; e = e->next) {
+		if (strcmp(e->name, name) == 0) {
+			proc = e->proc;
+			data = e->data;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&handler->mutex);
+	if (!proc)
+		return false;
+	proc(data, params);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* graphics                                                                  */
+
+static pthread_mutex_t graphics_mutex;
+static pthread_once_t graphics_once = PTHREAD_ONCE_INIT;
+static __thread int graphics_depth;
+
+static void graphics_mutex_init(void)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&graphics_mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+}
+
+void obs_enter_graphics(void)
+{
+	pthread_once(&graphics_once, graphics_mutex_init);
+	pthread_mutex_lock(&graphics_mutex);
+	graphics_depth++;
+}
+
+void obs_leave_graphics(void)
+{
+	graphics_depth--;
+	pthread_mutex_unlock(&graphics_mutex);
+}
+
+static void check_graphics(const char *func)
+{
+	if (graphics_depth > 0)
+		return;
+	if (os_atomic_inc_long(&graphics_violations) <= 10)
+		blog(LOG_WARNING, "%s called outside the graphics context",
+		     func);
+}
+
+/* pixels aren't kept, a texture only knows which browser paint it shows */
+struct gs_texture {
+	uint32_t cx;
+	uint32_t cy;
+	enum gs_color_format format;
+	uint32_t picture;
+};
+
+struct gs_texture_render {
+	enum gs_color_format format;
+	gs_texture_t *target;
+	gs_texture_t *previous;
+	bool rendered;
+};
+
+struct gs_effect_param {
+	struct gs_effect_param *next;
+	char *name;
+};
+
+struct gs_effect {
+	struct gs_effect_param *params;
+	bool looping;
+};
+
+struct gs_stage_surface {
+	uint32_t cx;
+	uint32_t cy;
+	uint8_t *data;
+};
+
+struct gs_timer {
+	bool ended;
+};
+
+struct gs_timer_range {
+	bool ended;
+};
+
+static pthread_mutex_t effect_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct gs_effect base_effect;
+static bool framebuffer_srgb;
+static bool linear_srgb;
+/* NULL while drawing to the output */
+static gs_texture_t *render_target;
+static gs_texture_t *bound_texture;
+
+static void free_texture(gs_texture_t *tex)
+{
+	if (bound_texture == tex)
+		bound_texture = NULL;
+	free(tex);
+}
+
+gs_effect_t *gs_effect_create_from_file(const char *file, char **error_string)
+{
+	UNUSED_PARAMETER(file);
+	check_graphics(__func__);
+	if (os_atomic_load_bool(&fail_next_effect)) {
+		os_atomic_set_bool(&fail_next_effect, false);
+		if (error_string)
+			*error_string = bstrdup("stub: effect failed to load");
+		return NULL;
+	}
+	os_atomic_inc_long(&live_effects);
+	return calloc(1, sizeof(struct gs_effect));
+}
+
+void gs_effect_destroy(gs_effect_t *effect)
+{
+	if (!effect)
+		return;
+	check_graphics(__func__);
+	struct gs_effect_param *param = effect->params;
+	while (param) {
+		struct gs_effect_param *next = param->next;
+		free(param->name);
+		free(param);
+		param = next;
+	}
+	free(effect);
+	os_atomic_dec_long(&live_effects);
+}
+
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect,
+					 const char *name)
+{
+	if (!effect)
+		return NULL;
+	gs_effect_t *e = (gs_effect_t *)effect;
+	pthread_mutex_lock(&effect_mutex);
+	struct gs_effect_param *param = e->params;
+	while (param && strcmp(param->name, name) != 0)
+		param = param->next;
+	if (!param) {
+		param = calloc(1, sizeof(*param));
+		param->name = stub_strdup(name);
+		param->next = e->params;
+		e->params = param;
+	}
+	pthread_mutex_unlock(&effect_mutex);
+	return param;
+}
+
+void gs_effect_set_texture(gs_eparam_t *param, gs_texture_t *val)
+{
+	UNUSED_PARAMETER(param);
+	check_graphics(__func__);
+	bound_texture = val;
+}
+
+void gs_effect_set_texture_srgb(gs_eparam_t *param, gs_texture_t *val)
+{
+	UNUSED_PARAMETER(param);
+	check_graphics(__func__);
+	bound_texture = val;
+}
+
+void gs_effect_set_bool(gs_eparam_t *param, bool val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+	check_graphics(__func__);
+}
+
+void gs_effect_set_float(gs_eparam_t *param, float val)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(val);
+	check_graphics(__func__);
+}
+
+bool gs_effect_loop(gs_effect_t *effect, const char *name)
+{
+	UNUSED_PARAMETER(name);
+	check_graphics(__func__);
+	effect->looping = !effect->looping;
+	return effect->looping;
+}
+
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
+		    uint32_t height)
+{
+	UNUSED_PARAMETER(flip);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	check_graphics(__func__);
+	if (!tex)
+		tex = bound_texture;
+	if (render_target && tex)
+		render_target->picture = tex->picture;
+}
+
+gs_texrender_t *gs_texrender_create(enum gs_color_format format,
+				    enum gs_zstencil_format zsformat)
+{
+	UNUSED_PARAMETER(zsformat);
+	check_graphics(__func__);
+	gs_texrender_t *texrender = calloc(1, sizeof(*texrender));
+	texrender->format = format;
+	os_atomic_inc_long(&live_texrenders);
+	return texrender;
+}
+
+void gs_texrender_destroy(gs_texrender_t *texrender)
+{
+	if (!texrender)
+		return;
+	check_graphics(__func__);
+	free_texture(texrender->target);
+	free(texrender);
+	os_atomic_dec_long(&live_texrenders);
+}
+
+bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx, uint32_t cy)
+{
+	return gs_texrender_begin_with_color_space(texrender, cx, cy,
+						   GS_CS_SRGB);
+}
+
+bool gs_texrender_begin_with_color_space(gs_texrender_t *texrender,
+					 uint32_t cx, uint32_t cy,
+					 enum gs_color_space space)
+{
+	UNUSED_PARAMETER(space);
+	check_graphics(__func__);
+	if (!texrender || texrender->rendered || !cx || !cy)
+		return false;
+	if (!texrender->target || texrender->target->cx != cx ||
+	    texrender->target->cy != cy) {
+		free_texture(texrender->target);
+		texrender->target = calloc(1, sizeof(gs_texture_t));
+		texrender->target->cx = cx;
+		texrender->target->cy = cy;
+		texrender->target->format = texrender->format;
+	}
+	texrender->previous = render_target;
+	render_target = texrender->target;
+	return true;
+}
+
+void gs_texrender_end(gs_texrender_t *texrender)
+{
+	check_graphics(__func__);
+	texrender->rendered = true;
+	render_target = texrender->previous;
+}
+
+void gs_texrender_reset(gs_texrender_t *texrender)
+{
+	if (texrender)
+		texrender->rendered = false;
+}
+
+gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender)
+{
+	return texrender ? texrender->target : NULL;
+}
+
+enum gs_color_format gs_texrender_get_format(const gs_texrender_t *texrender)
+{
+	return texrender->format;
+}
+
+uint32_t stub_texture_get_picture(gs_texture_t *tex)
+{
+	return tex ? tex->picture : 0;
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex->cx;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex->cy;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+uint32_t gs_get_format_bpp(enum gs_color_format format)
+{
+	return format == GS_RGBA16F ? 64 : 32;
+}
+
+enum gs_color_format gs_get_format_from_space(enum gs_color_space space)
+{
+	return space == GS_CS_SRGB ? GS_RGBA : GS_RGBA16F;
+}
+
+enum gs_color_space gs_get_color_space(void)
+{
+	check_graphics(__func__);
+	return GS_CS_SRGB;
+}
+
+gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height,
+				       enum gs_color_format color_format)
+{
+	UNUSED_PARAMETER(color_format);
+	check_graphics(__func__);
+	gs_stagesurf_t *surf = calloc(1, sizeof(*surf));
+	surf->cx = width;
+	surf->cy = height;
+	surf->data = calloc((size_t)width * height, 4);
+	os_atomic_inc_long(&live_stagesurfs);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (!stagesurf)
+		return;
+	check_graphics(__func__);
+	free(stagesurf->data);
+	free(stagesurf);
+	os_atomic_dec_long(&live_stagesurfs);
+}
+
+void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src)
+{
+	check_graphics(__func__);
+	if (!src)
+		return;
+	const size_t pixels = (size_t)dst->cx * dst->cy;
+	for (size_t i = 0; i < pixels; i++)
+		memcpy(dst->data + i * 4, &src->picture, 4);
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			 uint32_t *linesize)
+{
+	check_graphics(__func__);
+	*data = stagesurf->data;
+	*linesize = stagesurf->cx * 4;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+	check_graphics(__func__);
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->cx;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->cy;
+}
+
+gs_timer_t *gs_timer_create(void)
+{
+	check_graphics(__func__);
+	os_atomic_inc_long(&live_timers);
+	return calloc(1, sizeof(gs_timer_t));
+}
+
+void gs_timer_destroy(gs_timer_t *timer)
+{
+	if (!timer)
+		return;
+	check_graphics(__func__);
+	free(timer);
+	os_atomic_dec_long(&live_timers);
+}
+
+void gs_timer_begin(gs_timer_t *timer)
+{
+	check_graphics(__func__);
+	timer->ended = false;
+}
+
+void gs_timer_end(gs_timer_t *timer)
+{
+	check_graphics(__func__);
+	timer->ended = true;
+}
+
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
+{
+	check_graphics(__func__);
+	*ticks = (uint64_t)os_atomic_load_long(&timer_ns);
+	return timer->ended;
+}
+
+gs_timer_range_t *gs_timer_range_create(void)
+{
+	check_graphics(__func__);
+	os_atomic_inc_long(&live_timers);
+	return calloc(1, sizeof(gs_timer_range_t));
+}
+
+void gs_timer_range_destroy(gs_timer_range_t *range)
+{
+	if (!range)
+		return;
+	check_graphics(__func__);
+	free(range);
+	os_atomic_dec_long(&live_timers);
+}
+
+void gs_timer_range_begin(gs_timer_range_t *range)
+{
+	check_graphics(__func__);
+	range->ended = false;
+}
+
+void gs_timer_range_end(gs_timer_range_t *range)
+{
+	check_graphics(__func__);
+	range->ended = true;
+}
+
+bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
+			     uint64_t *frequency)
+{
+	check_graphics(__func__);
+	*disjoint = false;
+	*frequency = 1000000000ULL;
+	return range->ended;
+}
+
+bool gs_framebuffer_srgb_enabled(void)
+{
+	check_graphics(__func__);
+	return framebuffer_srgb;
+}
+
+void gs_enable_framebuffer_srgb(bool enable)
+{
+	check_graphics(__func__);
+	framebuffer_srgb = enable;
+}
+
+bool gs_set_linear_srgb(bool enable)
+{
+	check_graphics(__func__);
+	const bool previous = linear_srgb;
+	linear_srgb = enable;
+	return previous;
+}
+
+void gs_matrix_push(void)
+{
+	check_graphics(__func__);
+}
+
+void gs_matrix_pop(void)
+{
+	check_graphics(__func__);
+}
+
+void gs_matrix_scale3f(float x, float y, float z)
+{
+	UNUSED_PARAMETER(x);
+	UNUSED_PARAMETER(y);
+	UNUSED_PARAMETER(z);
+	check_graphics(__func__);
+}
+
+void gs_matrix_translate3f(float x, float y, float z)
+{
+	UNUSED_PARAMETER(x);
+	UNUSED_PARAMETER(y);
+	UNUSED_PARAMETER(z);
+	check_graphics(__func__);
+}
+
+void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth,
+	      uint8_t stencil)
+{
+	UNUSED_PARAMETER(clear_flags);
+	UNUSED_PARAMETER(color);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+	check_graphics(__func__);
+}
+
+void gs_ortho(float left, float right, float top, float bottom, float znear,
+	      float zfar)
+{
+	UNUSED_PARAMETER(left);
+	UNUSED_PARAMETER(right);
+	UNUSED_PARAMETER(top);
+	UNUSED_PARAMETER(bottom);
+	UNUSED_PARAMETER(znear);
+	UNUSED_PARAMETER(zfar);
+	check_graphics(__func__);
+}
+
+void gs_blend_state_push(void)
+{
+	check_graphics(__func__);
+}
+
+void gs_blend_state_pop(void)
+{
+	check_graphics(__func__);
+}
+
+void gs_enable_blending(bool enable)
+{
+	UNUSED_PARAMETER(enable);
+	check_graphics(__func__);
+}
+
+/* ------------------------------------------------------------------------- */
+/* properties                                                                */
+
+struct obs_property {
+	struct obs_property *next;
+	char *name;
+	obs_properties_t *parent;
+	obs_properties_t *group;
+	obs_property_clicked_t clicked;
+	void *priv;
+};
+
+struct obs_properties {
+	struct obs_property *first;
+	uint32_t flags;
+};
+
+obs_properties_t *obs_properties_create(void)
+{
+	os_atomic_inc_long(&live_properties);
+	return calloc(1, sizeof(obs_properties_t));
+}
+
+static void property_free(obs_property_t *p)
+{
+	obs_properties_destroy(p->group);
+	free(p->name);
+	free(p);
+}
+
+void obs_properties_destroy(obs_properties_t *props)
+{
+	if (!props)
+		return;
+	obs_property_t *p = props->first;
+	while (p) {
+		obs_property_t *next = p->next;
+		property_free(p);
+		p = next;
+	}
+	free(props);
+	os_atomic_dec_long(&live_properties);
+}
+
+void obs_properties_set_flags(obs_properties_t *props, uint32_t flags)
+{
+	if (props)
+		props->flags = flags;
+}
+
+obs_property_t *obs_properties_get(obs_properties_t *props, const char *name)
+{
+	if (!props)
+		return NULL;
+	for (obs_property_t *p = props->first; p; p = p->next) {
+		if (strcmp(p->name, name) == 0)
+			return p;
+		obs_property_t *child = obs_properties_get(p->group, name);
+		if (child)
+			return child;
+	}
+	return NULL;
+}
+
+void obs_properties_remove_by_name(obs_properties_t *props, const char *name)
+{
+	if (!props)
+		return;
+	for (obs_property_t **p = &props->first; *p; p = &(*p)->next) {
+		if (strcmp((*p)->name, name) == 0) {
+			obs_property_t *removed = *p;
+			*p = removed->next;
+			property_free(removed);
+			return;
+		}
+		obs_properties_remove_by_name((*p)->group, name);
+	}
+}
+
+static obs_property_t *property_add(obs_properties_t *props, const char *name)
+{
+	if (!props || obs_properties_get(props, name))
+		return NULL;
+	obs_property_t *p = calloc(1, sizeof(*p));
+	p->name = stub_strdup(name);
+	p->parent = props;
+	obs_property_t **last = &props->first;
+	while (*last)
+		last = &(*last)->next;
+	*last = p;
+	return p;
+}
+
+obs_property_t *obs_properties_add_float(obs_properties_t *props,
+					 const char *name, const char *desc,
+					 double min, double max, double step)
+{
+	UNUSED_PARAMETER(desc);
+	UNUSED_PARAMETER(min);
+	UNUSED_PARAMETER(max);
+	UNUSED_PARAMETER(step);
+	return property_add(props, name);
+}
+
+obs_property_t *obs_properties_add_float_slider(obs_properties_t *props,
+						const char *name,
+						const char *desc, double min,
+						double max, double step)
+{
+	return obs_properties_add_float(props, name, desc, min, max, step);
+}
+
+obs_property_t *obs_properties_add_int(obs_properties_t *props,
+				       const char *name, const char *desc,
+				       int min, int max, int step)
+{
+	UNUSED_PARAMETER(desc);
+	UNUSED_PARAMETER(min);
+	UNUSED_PARAMETER(max);
+	UNUSED_PARAMETER(step);
+	return property_add(props, name);
+}
+
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props,
+					      const char *name,
+					      const char *desc, int min,
+					      int max, int step)
+{
+	return obs_properties_add_int(props, name, desc, min, max, step);
+}
+
+obs_property_t *obs_properties_add_bool(obs_properties_t *props,
+					const char *name, const char *desc)
+{
+	UNUSED_PARAMETER(desc);
+	return property_add(props, name);
+}
+
+obs_property_t *obs_properties_add_list(obs_properties_t *props,
+					const char *name, const char *desc,
+					enum obs_combo_type type,
+					enum obs_combo_format format)
+{
+	UNUSED_PARAMETER(desc);
+	UNUSED_PARAMETER(type);
+	UNUSED_PARAMETER(format);
+	return property_add(props, name);
+}
+
+obs_property_t *obs_properties_add_group(obs_properties_t *props,
+					 const char *name, const char *desc,
+					 enum obs_group_type type,
+					 obs_properties_t *group)
+{
+	UNUSED_PARAMETER(desc);
+	UNUSED_PARAMETER(type);
+	obs_property_t *p = property_add(props, name);
+	if (p)
+		p->group = group;
+	return p;
+}
+
+obs_property_t *obs_properties_add_text(obs_properties_t *props,
+					const char *name, const char *desc,
+					enum obs_text_type type)
+{
+	UNUSED_PARAMETER(desc);
+	UNUSED_PARAMETER(type);
+	return property_add(props, name);
+}
+
+obs_property_t *obs_properties_add_path(obs_properties_t *props,
+					const char *name, const char *desc,
+					enum obs_path_type type,
+					const char *filter,
+					const char *default_path)
+{
+	UNUSED_PARAMETER(desc);
+	UNUSED_PARAMETER(type);
+	UNUSED_PARAMETER(filter);
+	UNUSED_PARAMETER(default_path);
+	return property_add(props, name);
+}
+
+obs_property_t *obs_properties_add_button2(obs_properties_t *props,
+					   const char *name, const char *text,
+					   obs_property_clicked_t callback,
+					   void *priv)
+{
+	UNUSED_PARAMETER(text);
+	obs_property_t *p = property_add(props, name);
+	if (p) {
+		p->clicked = callback;
+		p->priv = priv;
+	}
+	return p;
+}
+
+void obs_property_float_set_suffix(obs_property_t *p, const char *suffix)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(suffix);
+}
+
+void obs_property_int_set_suffix(obs_property_t *p, const char *suffix)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(suffix);
+}
+
+size_t obs_property_list_add_int(obs_property_t *p, const char *name,
+				 long long val)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(name);
+	UNUSED_PARAMETER(val);
+	return 0;
+}
+
+size_t obs_property_list_add_string(obs_property_t *p, const char *name,
+				    const char *val)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(name);
+	UNUSED_PARAMETER(val);
+	return 0;
+}
+
+void obs_property_set_modified_callback(obs_property_t *p,
+					obs_property_modified_t modified)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(modified);
+}
+
+void obs_property_set_modified_callback2(obs_property_t *p,
+					 obs_property_modified2_t modified,
+					 void *priv)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(modified);
+	UNUSED_PARAMETER(priv);
+}
+
+void obs_property_set_visible(obs_property_t *p, bool visible)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(visible);
+}
+
+void obs_property_set_description(obs_property_t *p, const char *description)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(description);
+}
+
+bool obs_property_button_clicked(obs_property_t *p, void *obj)
+{
+	if (!p || !p->clicked)
+		return false;
+	return p->clicked(p->parent, p, p->priv ? p->priv : obj);
+}
+
+/* ------------------------------------------------------------------------- */
+/* sources                                                                   */
+
+struct obs_weak_source {
+	volatile long refs;
+	obs_source_t *source;
+};
+
+struct obs_source {
+	struct obs_source *next;
+	char *name;
+	char *id;
+	const struct obs_source_info *info;
+	void *data;
+	obs_data_t *settings;
+	proc_handler_t *procs;
+	obs_weak_source_t *control;
+	uint32_t output_flags;
+	bool is_public;
+
+	volatile long refs;
+	volatile long width;
+	volatile long height;
+	volatile long active;
+	volatile long showing;
+	volatile long restarts;
+	volatile long paints;
+	volatile long deferred_update;
+	volatile long time_us;
+	volatile long duration_ms;
+};
+
+static pthread_mutex_t sources_mutex = PTHREAD_MUTEX_INITIALIZER;
+static obs_source_t *first_source;
+static struct obs_source_info *transition_info;
+static volatile long javascript_events;
+
+void obs_register_source(struct obs_source_info *info)
+{
+	if (info->type == OBS_SOURCE_TYPE_TRANSITION)
+		transition_info = info;
+}
+
+char *obs_module_file(const char *file)
+{
+	return bstrdup(file);
+}
+
+const char *obs_module_text(const char *lookup_string)
+{
+	return lookup_string;
+}
+
+static void javascript_event(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	const char *name;
+	if (calldata_get_string(cd, "eventName", &name))
+		os_atomic_inc_long(&javascript_events);
+}
+
+/* video children pick up their new size on the next tick, like the real
+ * ones do in their deferred update */
+static void apply_size(obs_source_t *source)
+{
+	long cx = (long)obs_data_get_int(source->settings, "width");
+	long cy = (long)obs_data_get_int(source->settings, "height");
+	if (!cx || !cy) {
+		cx = 1920;
+		cy = 1080;
+	}
+	os_atomic_set_long(&source->width, cx);
+	os_atomic_set_long(&source->height, cy);
+}
+
+static obs_source_t *source_new(const char *id, const char *name,
+				const struct obs_source_info *info)
+{
+	obs_source_t *source = calloc(1, sizeof(*source));
+	source->id = stub_strdup(id);
+	source->name = stub_strdup(name ? name : "");
+	source->info = info;
+	source->settings = obs_data_create();
+	source->procs = proc_handler_create();
+	source->control = calloc(1, sizeof(obs_weak_source_t));
+	source->control->refs = 1;
+	source->control->source = source;
+	source->refs = 1;
+	source->output_flags = info ? info->output_flags : OBS_SOURCE_VIDEO;
+	os_atomic_inc_long(&live_sources);
+
+	pthread_mutex_lock(&sources_mutex);
+	source->next = first_source;
+	first_source = source;
+	pthread_mutex_unlock(&sources_mutex);
+	return source;
+}
+
+obs_source_t *obs_source_create_private(const char *id, const char *name,
+					obs_data_t *settings)
+{
+	obs_source_t *source = source_new(id, name, NULL);
+	obs_data_t *defaults = obs_get_source_defaults(id);
+	data_lock();
+	for (struct obs_data_item *i = defaults->first; i; i = i->next)
+		set_value(source->settings, i->name, i->type, i->numtype,
+			  &i->def, true);
+	data_unlock();
+	obs_data_release(defaults);
+	data_apply(source->settings, settings);
+	apply_size(source);
+
+	if (strcmp(id, "browser_source") == 0)
+		proc_handler_add(source->procs,
+				 "void javascript_event(in string eventName, in string jsonString)",
+				 javascript_event, source);
+	return source;
+}
+
+obs_source_t *stub_source_create(const char *id, const char *name, uint32_t cx,
+				 uint32_t cy)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "width", cx);
+	obs_data_set_int(settings, "height", cy);
+	obs_source_t *source = obs_source_create_private(id, name, settings);
+	obs_data_release(settings);
+	pthread_mutex_lock(&sources_mutex);
+	source->is_public = true;
+	pthread_mutex_unlock(&sources_mutex);
+	return source;
+}
+
+static void weak_release(obs_weak_source_t *weak)
+{
+	if (os_atomic_dec_long(&weak->refs) == 0)
+		free(weak);
+}
+
+void obs_source_release(obs_source_t *source)
+{
+	if (!source || os_atomic_dec_long(&source->refs) > 0)
+		return;
+
+	pthread_mutex_lock(&sources_mutex);
+	for (obs_source_t **s = &first_source; *s; s = &(*s)->next) {
+		if (*s == source) {
+			*s = source->next;
+			break;
+		}
+	}
+	source->control->source = NULL;
+	pthread_mutex_unlock(&sources_mutex);
+
+	if (source->data && source->info && source->info->destroy)
+		source->info->destroy(source->data);
+
+	obs_data_release(source->settings);
+	proc_handler_destroy(source->procs);
+	weak_release(source->control);
+	free(source->name);
+	free(source->id);
+	free(source);
+	os_atomic_dec_long(&live_sources);
+}
+
+obs_source_t *obs_source_get_ref(obs_source_t *source)
+{
+	if (!source)
+		return NULL;
+	long refs = os_atomic_load_long(&source->refs);
+	while (refs > 0) {
+		if (os_atomic_compare_swap_long(&source->refs, refs, refs + 1))
+			return source;
+		refs = os_atomic_load_long(&source->refs);
+	}
+	return NULL;
+}
+
+obs_weak_source_t *obs_source_get_weak_source(obs_source_t *source)
+{
+	if (!source)
+		return NULL;
+	os_atomic_inc_long(&source->control->refs);
+	os_atomic_inc_long(&live_weak_refs);
+	return source->control;
+}
+
+obs_source_t *obs_weak_source_get_source(obs_weak_source_t *weak)
+{
+	if (!weak)
+		return NULL;
+	pthread_mutex_lock(&sources_mutex);
+	obs_source_t *source = obs_source_get_ref(weak->source);
+	pthread_mutex_unlock(&sources_mutex);
+	return source;
+}
+
+void obs_weak_source_release(obs_weak_source_t *weak)
+{
+	if (!weak)
+		return;
+	os_atomic_dec_long(&live_weak_refs);
+	weak_release(weak);
+}
+
+obs_source_t *obs_get_source_by_name(const char *name)
+{
+	obs_source_t *found = NULL;
+	pthread_mutex_lock(&sources_mutex);
+	for (obs_source_t *s = first_source; s && !found; s = s->next)
+		if (s->is_public && strcmp(s->name, name) == 0)
+			found = obs_source_get_ref(s);
+	pthread_mutex_unlock(&sources_mutex);
+	return found;
+}
+
+/* takes a reference to every source so callbacks can run unlocked */
+static obs_source_t **snapshot_sources(size_t *count, bool public_only)
+{
+	pthread_mutex_lock(&sources_mutex);
+	size_t n = 0;
+	for (obs_source_t *s = first_source; s; s = s->next)
+		n++;
+	obs_source_t **list = calloc(n ? n : 1, sizeof(obs_source_t *));
+	*count = 0;
+	for (obs_source_t *s = first_source; s; s = s->next) {
+		if (public_only && !s->is_public)
+			continue;
+		obs_source_t *ref = obs_source_get_ref(s);
+		if (ref)
+			list[(*count)++] = ref;
+	}
+	pthread_mutex_unlock(&sources_mutex);
+	return list;
+}
+
+static void release_snapshot(obs_source_t **list, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		obs_source_release(list[i]);
+	free(list);
+}
+
+void obs_enum_sources(bool (*enum_proc)(void *, obs_source_t *), void *param)
+{
+	size_t count;
+	obs_source_t **list = snapshot_sources(&count, true);
+	for (size_t i = 0; i < count; i++)
+		if (!enum_proc(param, list[i]))
+			break;
+	release_snapshot(list, count);
+}
+
+const char *obs_source_get_name(const obs_source_t *source)
+{
+	return source ? source->name : NULL;
+}
+
+const char *obs_source_get_id(const obs_source_t *source)
+{
+	return source ? source->id : NULL;
+}
+
+uint32_t obs_source_get_output_flags(const obs_source_t *source)
+{
+	return source ? source->output_flags : 0;
+}
+
+uint32_t obs_source_get_width(obs_source_t *source)
+{
+	return source ? (uint32_t)os_atomic_load_long(&source->width) : 0;
+}
+
+uint32_t obs_source_get_height(obs_source_t *source)
+{
+	return source ? (uint32_t)os_atomic_load_long(&source->height) : 0;
+}
+
+bool obs_source_active(const obs_source_t *source)
+{
+	return source && os_atomic_load_long(&source->active) > 0;
+}
+
+bool obs_source_showing(const obs_source_t *source)
+{
+	return source && os_atomic_load_long(&source->showing) > 0;
+}
+
+long stub_source_get_active_count(obs_source_t *source)
+{
+	return os_atomic_load_long(&source->active);
+}
+
+void obs_source_update(obs_source_t *source, obs_data_t *settings)
+{
+	if (!source)
+		return;
+	data_apply(source->settings, settings);
+
+	/* video sources update on the next tick, the transition isn't one and
+	 * updates right away once it has been created */
+	if ((source->output_flags & OBS_SOURCE_VIDEO) || !source->data)
+		os_atomic_inc_long(&source->deferred_update);
+	else if (source->info && source->info->update)
+		source->info->update(source->data, source->settings);
+}
+
+obs_data_t *obs_source_get_settings(const obs_source_t *source)
+{
+	if (!source)
+		return NULL;
+	obs_data_addref(source->settings);
+	return source->settings;
+}
+
+void obs_source_video_render(obs_source_t *source)
+{
+	check_graphics(__func__);
+	if (render_target && source)
+		render_target->picture =
+			(uint32_t)os_atomic_load_long(&source->paints);
+}
+
+enum gs_color_space
+obs_source_get_color_space(obs_source_t *source, size_t count,
+			   const enum gs_color_space *preferred_spaces)
+{
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(count);
+	UNUSED_PARAMETER(preferred_spaces);
+	return GS_CS_SRGB;
+}
+
+void obs_source_set_monitoring_type(obs_source_t *source,
+				    enum obs_monitoring_type type)
+{
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(type);
+}
+
+void obs_source_set_volume(obs_source_t *source, float volume)
+{
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(volume);
+}
+
+void obs_source_set_muted(obs_source_t *source, bool muted)
+{
+	UNUSED_PARAMETER(source);
+	UNUSED_PARAMETER(muted);
+}
+
+bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child)
+{
+	if (!parent || !child || parent == child)
+		return false;
+	os_atomic_inc_long(&child->active);
+	return true;
+}
+
+void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child)
+{
+	if (!parent || !child)
+		return;
+	if (os_atomic_dec_long(&child->active) < 0)
+		blog(LOG_ERROR, "stub: '%s' deactivated more than activated",
+		     child->name);
+}
+
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source)
+{
+	return source ? source->procs : NULL;
+}
+
+bool obs_source_audio_pending(const obs_source_t *source)
+{
+	UNUSED_PARAMETER(source);
+	return !os_atomic_load_bool(&child_audio);
+}
+
+uint64_t obs_source_get_audio_timestamp(const obs_source_t *source)
+{
+	UNUSED_PARAMETER(source);
+	return os_atomic_load_bool(&child_audio) ? 1 : 0;
+}
+
+static float silence[AUDIO_OUTPUT_FRAMES];
+
+void obs_source_get_audio_mix(const obs_source_t *source,
+			      struct obs_source_audio_mix *audio)
+{
+	UNUSED_PARAMETER(source);
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+		for (size_t ch = 0; ch < MAX_AUDIO_CHANNELS; ch++)
+			audio->output[mix].data[ch] = silence;
+}
+
+void obs_source_inc_showing(obs_source_t *source)
+{
+	if (source)
+		os_atomic_inc_long(&source->showing);
+}
+
+void obs_source_dec_showing(obs_source_t *source)
+{
+	if (source)
+		os_atomic_dec_long(&source->showing);
+}
+
+obs_properties_t *obs_source_properties(const obs_source_t *source)
+{
+	if (!source)
+		return NULL;
+	if (source->info && source->info->get_properties)
+		return source->info->get_properties(source->data);
+
+	obs_properties_t *props = obs_properties_create();
+	obs_properties_add_text(props, "url", "URL", OBS_TEXT_DEFAULT);
+	obs_properties_add_int(props, "width", "Width", 1, 8192, 1);
+	obs_properties_add_int(props, "height", "Height", 1, 8192, 1);
+	obs_properties_add_bool(props, "reroute_audio", "Reroute audio");
+	obs_properties_add_bool(props, "fps_custom", "Custom FPS");
+	obs_properties_add_int(props, "fps", "FPS", 1, 60, 1);
+	obs_properties_add_button2(props, "refreshnocache", "Refresh", NULL,
+				   NULL);
+	return props;
+}
+
+void obs_source_media_restart(obs_source_t *source)
+{
+	if (source)
+		os_atomic_inc_long(&source->restarts);
+}
+
+long stub_source_get_restart_count(obs_source_t *source)
+{
+	return os_atomic_load_long(&source->restarts);
+}
+
+/* ------------------------------------------------------------------------- */
+/* transitions                                                               */
+
+static struct gs_texture transition_textures[2];
+
+obs_source_t *stub_transition_create(const char *name, obs_data_t *settings)
+{
+	if (!transition_info)
+		return NULL;
+	obs_source_t *source =
+		source_new(transition_info->id, name, transition_info);
+	os_atomic_set_long(&source->width, 1920);
+	os_atomic_set_long(&source->height, 1080);
+	if (transition_info->get_defaults)
+		transition_info->get_defaults(source->settings);
+	data_apply(source->settings, settings);
+
+	void *data = transition_info->create(source->settings, source);
+	if (!data) {
+		blog(LOG_ERROR, "stub: failed to create transition '%s'", name);
+		obs_source_release(source);
+		return NULL;
+	}
+	source->data = data;
+	if (os_atomic_load_long(&source->deferred_update)) {
+		os_atomic_set_long(&source->deferred_update, 0);
+		transition_info->update(data, source->settings);
+	}
+	return source;
+}
+
+void stub_transition_set_time(obs_source_t *transition, float t)
+{
+	os_atomic_set_long(&transition->time_us, (long)(t * 1000000.0f));
+}
+
+void stub_transition_set_size(obs_source_t *transition, uint32_t cx,
+			      uint32_t cy)
+{
+	os_atomic_set_long(&transition->width, cx);
+	os_atomic_set_long(&transition->height, cy);
+}
+
+void stub_transition_start(obs_source_t *transition)
+{
+	stub_transition_set_time(transition, 0.0f);
+	transition->info->transition_start(transition->data);
+}
+
+void stub_transition_stop(obs_source_t *transition)
+{
+	transition->info->transition_stop(transition->data);
+}
+
+obs_properties_t *stub_transition_properties(obs_source_t *transition)
+{
+	return obs_source_properties(transition);
+}
+
+void stub_video_tick(float seconds)
+{
+	const long tick = os_atomic_inc_long(&ticks);
+	bool paint = tick % os_atomic_load_long(&paint_interval) == 0;
+	if (os_atomic_load_long(&stalled_paints) > 0 &&
+	    os_atomic_dec_long(&stalled_paints) >= 0)
+		paint = false;
+
+	size_t count;
+	obs_source_t **list = snapshot_sources(&count, false);
+	for (size_t i = 0; i < count; i++) {
+		obs_source_t *source = list[i];
+		if (paint && source->id &&
+		    strcmp(source->id, "browser_source") == 0)
+			os_atomic_inc_long(&source->paints);
+		const bool deferred =
+			os_atomic_load_long(&source->deferred_update) > 0;
+		if (deferred) {
+			os_atomic_set_long(&source->deferred_update, 0);
+			if (!source->info)
+				apply_size(source);
+			else if (source->data && source->info->update)
+				source->info->update(source->data,
+						     source->settings);
+		}
+		if (source->data && source->info && source->info->video_tick)
+			source->info->video_tick(source->data, seconds);
+	}
+	release_snapshot(list, count);
+}
+
+void stub_video_render(obs_source_t *transition)
+{
+	obs_enter_graphics();
+	transition->info->video_render(transition->data, NULL);
+	obs_leave_graphics();
+}
+
+bool stub_audio_render(obs_source_t *transition)
+{
+	static __thread float buffers[MAX_AUDIO_MIXES][2][AUDIO_OUTPUT_FRAMES];
+	struct obs_source_audio_mix audio;
+	memset(&audio, 0, sizeof(audio));
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+		for (size_t ch = 0; ch < 2; ch++)
+			audio.output[mix].data[ch] = buffers[mix][ch];
+
+	uint64_t ts = 0;
+	return transition->info->audio_render(transition->data, &ts, &audio,
+					      1, 2, 48000);
+}
+
+void obs_transition_enable_fixed(obs_source_t *transition, bool enable,
+				 uint32_t duration_ms)
+{
+	os_atomic_set_long(&transition->duration_ms,
+			   enable ? (long)duration_ms : 0);
+}
+
+float obs_transition_get_time(obs_source_t *transition)
+{
+	return (float)os_atomic_load_long(&transition->time_us) / 1000000.0f;
+}
+
+bool obs_transition_video_render(obs_source_t *transition,
+				 obs_transition_video_render_callback_t callback)
+{
+	check_graphics(__func__);
+	callback(transition->data, &transition_textures[0],
+		 &transition_textures[1], obs_transition_get_time(transition),
+		 obs_source_get_width(transition),
+		 obs_source_get_height(transition));
+	return true;
+}
+
+bool obs_transition_video_render_direct(obs_source_t *transition,
+					enum obs_transition_target target)
+{
+	UNUSED_PARAMETER(target);
+	check_graphics(__func__);
+	return obs_transition_get_time(transition) < 1.0f;
+}
+
+bool obs_transition_audio_render(obs_source_t *transition, uint64_t *ts_out,
+				 struct obs_source_audio_mix *audio,
+				 uint32_t mixers, size_t channels,
+				 size_t sample_rate,
+				 obs_transition_audio_mix_callback_t mix_a_callback,
+				 obs_transition_audio_mix_callback_t mix_b_callback)
+{
+	UNUSED_PARAMETER(sample_rate);
+	const float t = obs_transition_get_time(transition);
+	const float a = mix_a_callback(transition->data, t);
+	const float b = mix_b_callback(transition->data, t);
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) == 0)
+			continue;
+		for (size_t ch = 0; ch < channels; ch++)
+			audio->output[mix].data[ch][0] = a + b;
+	}
+	*ts_out = 1;
+	return true;
+}
+
+obs_source_t *obs_transition_get_active_source(obs_source_t *transition)
+{
+	UNUSED_PARAMETER(transition);
+	return NULL;
+}
+
+obs_source_t *obs_transition_get_source(obs_source_t *transition,
+					enum obs_transition_target target)
+{
+	UNUSED_PARAMETER(transition);
+	UNUSED_PARAMETER(target);
+	return NULL;
+}
+
+enum gs_color_space obs_transition_video_get_color_space(obs_source_t *source)
+{
+	UNUSED_PARAMETER(source);
+	return GS_CS_SRGB;
+}
+
+/* ------------------------------------------------------------------------- */
+/* settings                                                                  */
+
+/* in the working directory, two so a second path runs into the first */
+static const char *trace_files[] = {"stub-trace-0.json", "stub-trace-1.json"};
+
+void stub_random_settings(uint32_t *state, obs_data_t *settings,
+			  const char *matte_source)
+{
+	/* every layout against every matte source, including the ones that
+	 * can't be resolved */
+	obs_data_set_bool(settings, "track_matte_enabled",
+			  test_random_range(state, 2));
+	obs_data_set_int(settings, "track_matte_layout",
+			 test_random_range(state, 3));
+	obs_data_set_int(settings, "track_matte_source_type",
+			 test_random_range(state, 4));
+	obs_data_set_string(settings, "track_matte_file",
+			    test_random_range(state, 2) ? "matte.webm" : "");
+	obs_data_set_string(settings, "track_matte_url",
+			    test_random_range(state, 2)
+				    ? "https://example.com/matte"
+				    : "");
+	obs_data_set_string(settings, "track_matte_source",
+			    test_random_range(state, 2) ? matte_source
+							: "Missing");
+	obs_data_set_int(settings, "track_matte_scale",
+			 25 + test_random_range(state, 76));
+	obs_data_set_bool(settings, "invert_matte", test_random_range(state, 2));
+
+	obs_data_set_int(settings, "tp_type", test_random_range(state, 2));
+	obs_data_set_double(settings, "transition_point",
+			    10.0 + test_random_range(state, 81));
+	/* no duration now and then, the audio then falls back to the plain
+	 * transition point fades */
+	obs_data_set_double(settings, "duration",
+			    test_random_range(state, 8)
+				    ? 100.0 + test_random_range(state, 1900)
+				    : 0.0);
+	obs_data_set_double(settings, "transition_point_ms",
+			    50.0 + test_random_range(state, 1000));
+
+	/* one past the last style to cover the fallback */
+	obs_data_set_int(settings, "audio_fade_style",
+			 test_random_range(state, 4));
+	obs_data_set_double(settings, "audio_volume",
+			    test_random_range(state, 101));
+	obs_data_set_bool(settings, "adaptive_quality",
+			  test_random_range(state, 2));
+	obs_data_set_int(settings, "jitter_buffer", test_random_range(state, 4));
+	obs_data_set_bool(settings, "fps_custom", test_random_range(state, 2));
+	obs_data_set_int(settings, "fps", 10 + test_random_range(state, 51));
+
+	obs_data_set_bool(settings, "trace_enabled",
+			  test_random_range(state, 8) == 0);
+	obs_data_set_string(settings, "trace_file",
+			    trace_files[test_random_range(state, 2)]);
+}
+
+void stub_remove_trace_files(void)
+{
+	for (size_t i = 0; i < sizeof(trace_files) / sizeof(trace_files[0]);
+	     i++)
+		remove(trace_files[i]);
+}
+
+/* ------------------------------------------------------------------------- */
+/* core                                                                      */
+
+float obs_db_to_mul(float db)
+{
+	return isfinite(db) ? powf(10.0f, db / 20.0f) : 0.0f;
+}
+
+float obs_get_video_sdr_white_level(void)
+{
+	return 300.0f;
+}
+
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect)
+{
+	UNUSED_PARAMETER(effect);
+	return &base_effect;
+}
+
+obs_data_t *obs_get_source_defaults(const char *id)
+{
+	obs_data_t *data = obs_data_create();
+	if (id && strcmp(id, "browser_source") == 0) {
+		obs_data_set_default_string(data, "url",
+					    "https://obsproject.com/browser-source");
+		obs_data_set_default_int(data, "width", 800);
+		obs_data_set_default_int(data, "height", 600);
+		obs_data_set_default_bool(data, "fps_custom", false);
+		obs_data_set_default_int(data, "fps", 30);
+		obs_data_set_default_bool(data, "reroute_audio", false);
+		obs_data_set_default_string(data, "css", "");
+		obs_data_set_default_double(data, "zoom", 1.0);
+	}
+	return data;
+}
+
+bool obs_get_video_info(struct obs_video_info *ovi)
+{
+	ovi->fps_num = 60;
+	ovi->fps_den = 1;
+	ovi->base_width = ovi->output_width = 1920;
+	ovi->base_height = ovi->output_height = 1080;
+	return true;
+}
+
+bool obs_get_audio_info(struct obs_audio_info *oai)
+{
+	oai->samples_per_sec = 48000;
+	oai->speakers = 2;
+	return true;
+}
+
+uint32_t obs_get_lagged_frames(void)
+{
+	return (uint32_t)os_atomic_load_long(&lagged_frames);
+}
+
+static int video_output;
+
+video_t *obs_get_video(void)
+{
+	return (video_t *)&video_output;
+}
+
+uint32_t video_output_get_skipped_frames(const video_t *video)
+{
+	UNUSED_PARAMETER(video);
+	return 0;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+/*
+ * Test side of the stub libobs: drives the registered transition the way
+ * the OBS threads do, and counts every object the plugin creates so the
+ * tests can report leaks.
+ */
+
+#include "obs-module.h"
+#include "test-random.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct stub_counts {
+	/* objects alive right now */
+	long sources;
+	long weak_refs;
+	long data;
+	long properties;
+	long texrenders;
+	long stagesurfs;
+	long effects;
+	long timers;
+	long calldata;
+
+	/* bmalloc bytes */
+	long memory;
+	long peak_memory;
+
+	/* graphics calls made without obs_enter_graphics */
+	long graphics_violations;
+	long errors;
+};
+
+void stub_get_counts(struct stub_counts *counts);
+void stub_reset_peak_memory(void);
+void stub_set_log_level(int log_level);
+
+/* the next gs_effect_create_from_file fails like a broken effect file */
+void stub_fail_next_effect(void);
+
+/* browser children report audio, so the transition mixes it in */
+void stub_set_child_audio(bool enabled);
+void stub_add_lagged_frames(uint32_t frames);
+/* browser sources paint once every frames ticks, or not at all during the
+ * next frames ticks of a stall, textures they are rendered to show the
+ * number of that paint */
+void stub_set_paint_interval(uint32_t frames);
+void stub_stall_paints(uint32_t frames);
+uint32_t stub_texture_get_picture(gs_texture_t *tex);
+/* every gpu timer reads this, 0.1 ms unless set */
+void stub_set_timer_ns(uint32_t ns);
+
+/* the registered transition */
+obs_source_t *stub_transition_create(const char *name, obs_data_t *settings);
+void stub_transition_set_time(obs_source_t *transition, float t);
+void stub_transition_set_size(obs_source_t *transition, uint32_t cx,
+			      uint32_t cy);
+void stub_transition_start(obs_source_t *transition);
+void stub_transition_stop(obs_source_t *transition);
+obs_properties_t *stub_transition_properties(obs_source_t *transition);
+
+/* the video and audio threads: tick applies deferred updates of video
+ * children and calls video_tick, render enters the graphics context */
+void stub_video_tick(float seconds);
+void stub_video_render(obs_source_t *transition);
+bool stub_audio_render(obs_source_t *transition);
+
+/* a public source other transitions can use as their matte */
+obs_source_t *stub_source_create(const char *id, const char *name, uint32_t cx,
+				 uint32_t cy);
+long stub_source_get_active_count(obs_source_t *source);
+long stub_source_get_restart_count(obs_source_t *source);
+
+/* random transition settings for the soak and stress tests, matte_source
+ * names the existing source to use as a matte */
+void stub_random_settings(uint32_t *state, obs_data_t *settings,
+			  const char *matte_source);
+/* the settings sometimes trace to files in the working directory */
+void stub_remove_trace_files(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+/*
+ * The seeded random numbers of the tests, the same seed always gives the
+ * same run, also across platforms.
+ */
+
+#include <stdint.h>
+
+static inline uint32_t test_random(uint32_t *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static inline uint32_t test_random_range(uint32_t *state, uint32_t count)
+{
+	return test_random(state) % count;
+}
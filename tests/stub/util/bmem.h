@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *bmalloc(size_t size);
+void *bzalloc(size_t size);
+void *brealloc(void *ptr, size_t size);
+void bfree(void *ptr);
+char *bstrdup(const char *str);
+
+#ifdef __cplusplus
+}
+#endif
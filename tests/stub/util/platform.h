@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FILE *os_fopen(const char *path, const char *mode);
+uint64_t os_gettime_ns(void);
+void os_sleep_ms(uint32_t duration);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,760 @@
+/*
+ * Renders a browser transition to an image sequence without OBS or a GPU,
+ * using the same matte composite and frame schedule as the plugin.
+ *
+ * The stinger and matte come from a raw RGBA frame dump in the track matte
+ * layout (one frame per output frame, straight alpha), or from a generated
+ * wipe when no dump is given. Frame ranges are rendered in parallel.
+ */
+#define _FILE_OFFSET_BITS 64
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "matte-composite.h"
+#include "transition-schedule.h"
+
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
+
+#define MAX_THREADS 64
+
+enum layout {
+	LAYOUT_HORIZONTAL,
+	LAYOUT_VERTICAL,
+	LAYOUT_MASK,
+	LAYOUT_NONE,
+};
+
+struct frame_source {
+	bool testcard;
+	uint8_t color[4];
+};
+
+struct render_options {
+	uint32_t cx;
+	uint32_t cy;
+	uint32_t fps_num;
+	uint32_t fps_den;
+	double duration_ms;
+	double transition_point;
+	enum layout layout;
+	bool invert;
+	bool linear;
+	bool png;
+	const char *output;
+	const char *frames_path;
+	uint32_t media_cx;
+	uint32_t media_cy;
+	uint64_t frame_count;
+	uint64_t first;
+	uint64_t last;
+	int threads;
+
+	struct transition_schedule schedule;
+	uint8_t *a;
+	uint8_t *b;
+	float to_linear[256];
+};
+
+struct render_job {
+	const struct render_options *opt;
+	uint64_t first;
+	uint64_t last;
+	bool failed;
+};
+
+/* ------------------------------------------------------------------------- */
+/* png, stored deflate blocks only so no zlib is needed                      */
+
+struct png_writer {
+	FILE *file;
+	uint32_t crc;
+	uint32_t adler_a;
+	uint32_t adler_b;
+};
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void init_crc_table(void)
+{
+	for (uint32_t n = 0; n < 256; n++) {
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++)
+			c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		crc_table[n] = c;
+	}
+}
+
+static void png_write(struct png_writer *w, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++)
+		w->crc = crc_table[(w->crc ^ bytes[i]) & 0xff] ^ (w->crc >> 8);
+	fwrite(data, 1, size, w->file);
+}
+
+static void png_write_u32(struct png_writer *w, uint32_t v)
+{
+	const uint8_t bytes[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16),
+				  (uint8_t)(v >> 8), (uint8_t)v};
+	png_write(w, bytes, 4);
+}
+
+static void png_chunk_begin(struct png_writer *w, const char *type,
+			    uint32_t size)
+{
+	png_write_u32(w, size);
+	w->crc = 0xffffffffu;
+	png_write(w, type, 4);
+}
+
+static void png_chunk_end(struct png_writer *w)
+{
+	png_write_u32(w, w->crc ^ 0xffffffffu);
+}
+
+/* image data bytes are also summed for the zlib trailer */
+static void png_write_data(struct png_writer *w, const uint8_t *data,
+			   size_t size)
+{
+	/* 5552 bytes is the most that can be summed before the modulo
+	 * without overflowing */
+	for (size_t start = 0; start < size; start += 5552) {
+		const size_t end = size - start > 5552 ? start + 5552 : size;
+		for (size_t i = start; i < end; i++) {
+			w->adler_a += data[i];
+			w->adler_b += w->adler_a;
+		}
+		w->adler_a %= 65521;
+		w->adler_b %= 65521;
+	}
+	png_write(w, data, size);
+}
+
+static bool write_png(const char *path, const uint8_t *rgba, uint32_t cx,
+		      uint32_t cy)
+{
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G',
+					     '\r', '\n', 0x1a, '\n'};
+	const size_t row = (size_t)cx * 4 + 1;
+	const size_t raw = row * cy;
+	const size_t blocks = (raw + 65534) / 65535;
+	const size_t idat = 2 + blocks * 5 + raw + 4;
+	if (idat > 0x7fffffffu)
+		return false;
+
+	struct png_writer w = {.file = fopen(path, "wb"),
+			       .adler_a = 1,
+			       .adler_b = 0};
+	if (!w.file)
+		return false;
+	pthread_once(&crc_once, init_crc_table);
+
+	fwrite(signature, 1, sizeof(signature), w.file);
+
+	png_chunk_begin(&w, "IHDR", 13);
+	png_write_u32(&w, cx);
+	png_write_u32(&w, cy);
+	const uint8_t ihdr[5] = {8, 6, 0, 0, 0};
+	png_write(&w, ihdr, sizeof(ihdr));
+	png_chunk_end(&w);
+
+	png_chunk_begin(&w, "IDAT", (uint32_t)idat);
+	const uint8_t zlib_header[2] = {0x78, 0x01};
+	png_write(&w, zlib_header, 2);
+
+	/* rows start with filter type 0, blocks may split a row anywhere */
+	size_t written = 0;
+	size_t block_left = 0;
+	const uint8_t filter = 0;
+	for (uint32_t y = 0; y < cy; y++) {
+		const uint8_t *line = rgba + (size_t)y * cx * 4;
+		size_t offset = 0;
+		while (offset < row) {
+			if (!block_left) {
+				block_left = raw - written < 65535
+						     ? raw - written
+						     : 65535;
+				const uint8_t header[5] = {
+					written + block_left == raw ? 1 : 0,
+					(uint8_t)block_left,
+					(uint8_t)(block_left >> 8),
+					(uint8_t)~block_left,
+					(uint8_t)(~block_left >> 8)};
+				png_write(&w, header, 5);
+			}
+			size_t n = row - offset;
+			if (n > block_left)
+				n = block_left;
+			if (offset == 0) {
+				png_write_data(&w, &filter, 1);
+				offset++;
+				n--;
+				written++;
+				block_left--;
+			}
+			png_write_data(&w, line + offset - 1, n);
+			offset += n;
+			written += n;
+			block_left -= n;
+		}
+	}
+
+	png_write_u32(&w, (w.adler_b << 16) | w.adler_a);
+	png_chunk_end(&w);
+
+	png_chunk_begin(&w, "IEND", 0);
+	png_chunk_end(&w);
+
+	const bool ok = !ferror(w.file);
+	return fclose(w.file) == 0 && ok;
+}
+
+static bool write_raw(const char *path, const uint8_t *rgba, uint32_t cx,
+		      uint32_t cy)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file)
+		return false;
+	const size_t size = (size_t)cx * cy * 4;
+	const bool ok = fwrite(rgba, 1, size, file) == size;
+	return fclose(file) == 0 && ok;
+}
+
+/* ------------------------------------------------------------------------- */
+/* inputs                                                                    */
+
+static void fill_frame(uint8_t *rgba, uint32_t cx, uint32_t cy,
+		       const struct frame_source *src)
+{
+	static const uint8_t bars[8][3] = {
+		{192, 192, 192}, {192, 192, 0}, {0, 192, 192}, {0, 192, 0},
+		{192, 0, 192},   {192, 0, 0},   {0, 0, 192},   {16, 16, 16},
+	};
+
+	for (uint32_t y = 0; y < cy; y++) {
+		uint8_t *pixel = rgba + (size_t)y * cx * 4;
+		for (uint32_t x = 0; x < cx; x++, pixel += 4) {
+			if (!src->testcard) {
+				memcpy(pixel, src->color, 4);
+				continue;
+			}
+			if (y < cy - cy / 4) {
+				const uint8_t *bar = bars[(uint64_t)x * 8 / cx];
+				pixel[0] = bar[0];
+				pixel[1] = bar[1];
+				pixel[2] = bar[2];
+			} else {
+				const uint32_t max_x = cx > 1 ? cx - 1 : 1;
+				const uint8_t v =
+					(uint8_t)((uint64_t)x * 255 / max_x);
+				pixel[0] = pixel[1] = pixel[2] = v;
+			}
+			pixel[3] = 255;
+		}
+	}
+}
+
+/* bilinear scale of a region of the media frame to the canvas, the same
+ * filter the plugin uses when it draws the browser */
+static void scale_region(uint8_t *out, uint32_t cx, uint32_t cy,
+			 const uint8_t *media, uint32_t media_cx,
+			 uint32_t region_x, uint32_t region_y,
+			 uint32_t region_cx, uint32_t region_cy)
+{
+	const float sx = (float)region_cx / (float)cx;
+	const float sy = (float)region_cy / (float)cy;
+
+	for (uint32_t y = 0; y < cy; y++) {
+		float fy = ((float)y + 0.5f) * sy - 0.5f;
+		if (fy < 0.0f)
+			fy = 0.0f;
+		uint32_t y0 = (uint32_t)fy;
+		if (y0 >= region_cy - 1)
+			y0 = region_cy > 1 ? region_cy - 2 : 0;
+		const uint32_t y1 = region_cy > 1 ? y0 + 1 : y0;
+		const float wy = fy - (float)y0 > 1.0f ? 1.0f : fy - (float)y0;
+
+		const size_t stride = (size_t)media_cx * 4;
+		const uint8_t *row0 = media + (region_y + y0) * stride +
+				      (size_t)region_x * 4;
+		const uint8_t *row1 = media + (region_y + y1) * stride +
+				      (size_t)region_x * 4;
+		uint8_t *pixel = out + (size_t)y * cx * 4;
+
+		for (uint32_t x = 0; x < cx; x++, pixel += 4) {
+			float fx = ((float)x + 0.5f) * sx - 0.5f;
+			if (fx < 0.0f)
+				fx = 0.0f;
+			uint32_t x0 = (uint32_t)fx;
+			if (x0 >= region_cx - 1)
+				x0 = region_cx > 1 ? region_cx - 2 : 0;
+			const uint32_t x1 = region_cx > 1 ? x0 + 1 : x0;
+			const float wx =
+				fx - (float)x0 > 1.0f ? 1.0f : fx - (float)x0;
+
+			for (int c = 0; c < 4; c++) {
+				const float top = row0[x0 * 4 + c] +
+						  (row0[x1 * 4 + c] -
+						   row0[x0 * 4 + c]) *
+							  wx;
+				const float bottom = row1[x0 * 4 + c] +
+						     (row1[x1 * 4 + c] -
+						      row1[x0 * 4 + c]) *
+							     wx;
+				pixel[c] = (uint8_t)(top + (bottom - top) * wy +
+						     0.5f);
+			}
+		}
+	}
+}
+
+/* stand-in for a stinger page: a bar sweeping across the canvas with a
+ * soft wipe behind it as the matte */
+static void generate_wipe(uint8_t *stinger, uint8_t *matte, uint32_t cx,
+			  uint32_t cy, float t)
+{
+	const float band = (float)cx * 0.2f;
+	const float soft = (float)cx * 0.05f;
+	const float edge = t * ((float)cx + band * 2.0f) - band;
+
+	for (uint32_t y = 0; y < cy; y++) {
+		uint8_t *s = stinger + (size_t)y * cx * 4;
+		uint8_t *m = matte + (size_t)y * cx * 4;
+		for (uint32_t x = 0; x < cx; x++, s += 4, m += 4) {
+			const float d = edge - (float)x;
+			float v = d / soft + 0.5f;
+			v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+			m[0] = m[1] = m[2] = (uint8_t)(v * 255.0f + 0.5f);
+			m[3] = 255;
+
+			const bool inside = d > -band * 0.5f &&
+					    d < band * 0.5f;
+			s[0] = 240;
+			s[1] = 96;
+			s[2] = 32;
+			s[3] = inside ? 255 : 0;
+		}
+	}
+}
+
+static bool read_media_frame(FILE *file, uint8_t *media, size_t size,
+			     uint64_t index)
+{
+	return fseek64(file, (long long)(index * size), SEEK_SET) == 0 &&
+	       fread(media, 1, size, file) == size;
+}
+
+/* ------------------------------------------------------------------------- */
+/* rendering                                                                 */
+
+/* the plugin draws the stinger with linear sRGB blending on an sRGB
+ * framebuffer, so the blend happens on linear values */
+static void blend_over(uint8_t *dst, const uint8_t *src, size_t pixels,
+		       const float *to_linear)
+{
+	for (size_t i = 0; i < pixels; i++, dst += 4, src += 4) {
+		const uint8_t alpha = src[3];
+		if (!alpha)
+			continue;
+		if (alpha == 255) {
+			memcpy(dst, src, 3);
+			continue;
+		}
+
+		const float a = (float)alpha / 255.0f;
+		for (int c = 0; c < 3; c++) {
+			const float v = to_linear[src[c]] * a +
+					to_linear[dst[c]] * (1.0f - a);
+			const float e = matte_srgb_linear_to_nonlinear(v);
+			dst[c] = e >= 1.0f ? 255
+					   : (uint8_t)(e * 255.0f + 0.5f);
+		}
+	}
+}
+
+static float frame_time(const struct render_options *opt, uint64_t frame)
+{
+	/* what obs_transition_get_time returns on this frame */
+	const double ms = (double)frame * 1000.0 * (double)opt->fps_den /
+			  (double)opt->fps_num;
+	const double t = ms / opt->duration_ms;
+	return t > 1.0 ? 1.0f : (float)t;
+}
+
+static void *render_range(void *data)
+{
+	struct render_job *job = data;
+	const struct render_options *opt = job->opt;
+	const size_t pixels = (size_t)opt->cx * opt->cy;
+	const size_t media_size = (size_t)opt->media_cx * opt->media_cy * 4;
+
+	uint8_t *out = malloc(pixels * 4);
+	uint8_t *stinger = malloc(pixels * 4);
+	uint8_t *matte = malloc(pixels * 4);
+	uint8_t *media = opt->frames_path ? malloc(media_size) : NULL;
+	FILE *file = opt->frames_path ? fopen(opt->frames_path, "rb") : NULL;
+	char path[4096];
+
+	if (!out || !stinger || !matte || (opt->frames_path && !media) ||
+	    (opt->frames_path && !file)) {
+		job->failed = true;
+		goto done;
+	}
+
+	for (uint64_t frame = job->first; frame < job->last; frame++) {
+		const float t = frame_time(opt, frame);
+		const bool has_stinger = opt->layout != LAYOUT_MASK;
+		const bool has_matte = opt->layout != LAYOUT_NONE;
+
+		if (!file) {
+			generate_wipe(stinger, matte, opt->cx, opt->cy, t);
+		} else {
+			const uint64_t index = frame < opt->frame_count
+						       ? frame
+						       : opt->frame_count - 1;
+			if (!read_media_frame(file, media, media_size,
+					      index)) {
+				job->failed = true;
+				break;
+			}
+
+			const uint32_t half_cx = opt->media_cx / 2;
+			const uint32_t half_cy = opt->media_cy / 2;
+			switch (opt->layout) {
+			case LAYOUT_HORIZONTAL:
+				scale_region(stinger, opt->cx, opt->cy, media,
+					     opt->media_cx, 0, 0, half_cx,
+					     opt->media_cy);
+				scale_region(matte, opt->cx, opt->cy, media,
+					     opt->media_cx, half_cx, 0,
+					     half_cx, opt->media_cy);
+				break;
+			case LAYOUT_VERTICAL:
+				scale_region(stinger, opt->cx, opt->cy, media,
+					     opt->media_cx, 0, 0,
+					     opt->media_cx, half_cy);
+				scale_region(matte, opt->cx, opt->cy, media,
+					     opt->media_cx, 0, half_cy,
+					     opt->media_cx, half_cy);
+				break;
+			case LAYOUT_MASK:
+				scale_region(matte, opt->cx, opt->cy, media,
+					     opt->media_cx, 0, 0,
+					     opt->media_cx, opt->media_cy);
+				break;
+			case LAYOUT_NONE:
+				scale_region(stinger, opt->cx, opt->cy, media,
+					     opt->media_cx, 0, 0,
+					     opt->media_cx, opt->media_cy);
+				break;
+			}
+		}
+
+		if (has_matte) {
+			matte_composite_rgba8(out, opt->a, opt->b, matte,
+					      pixels, opt->invert,
+					      opt->linear);
+		} else {
+			const bool use_a =
+				opt->schedule.valid
+					? transition_schedule_use_a(
+						  &opt->schedule, t)
+					: t < opt->transition_point;
+			memcpy(out, use_a ? opt->a : opt->b, pixels * 4);
+		}
+		if (has_stinger)
+			blend_over(out, stinger, pixels, opt->to_linear);
+
+		snprintf(path, sizeof(path), "%s%05llu.%s", opt->output,
+			 (unsigned long long)frame, opt->png ? "png" : "rgba");
+		const bool ok =
+			opt->png ? write_png(path, out, opt->cx, opt->cy)
+				 : write_raw(path, out, opt->cx, opt->cy);
+		if (!ok) {
+			fprintf(stderr, "Could not write '%s'\n", path);
+			job->failed = true;
+			break;
+		}
+	}
+
+done:
+	if (file)
+		fclose(file);
+	free(media);
+	free(matte);
+	free(stinger);
+	free(out);
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* command line                                                              */
+
+static int cpu_count(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	long count = (long)info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (count < 1)
+		return 1;
+	return count > MAX_THREADS ? MAX_THREADS : (int)count;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options] -o <output prefix>\n"
+		"  --size WxH            canvas size (1920x1080)\n"
+		"  --fps N[/D]           canvas frame rate (60)\n"
+		"  --duration MS         transition duration (500)\n"
+		"  --point PERCENT       transition point (50)\n"
+		"  --a COLOR|testcard    scene A, COLOR is RRGGBB (000000)\n"
+		"  --b COLOR|testcard    scene B (testcard)\n"
+		"  --frames FILE         raw RGBA frame dump of the browser\n"
+		"  --media WxH           size of the frames in the dump\n"
+		"  --layout horizontal|vertical|mask|none (horizontal)\n"
+		"  --invert              invert the matte\n"
+		"  --linear              linear blend like a non sRGB canvas\n"
+		"  --format png|rgba     output format (png)\n"
+		"  --range FIRST-LAST    frames to render (all)\n"
+		"  --threads N           render threads (one per core)\n"
+		"Without --frames a generated wipe is used.\n",
+		name);
+}
+
+static bool parse_size(const char *s, uint32_t *cx, uint32_t *cy)
+{
+	unsigned int w, h;
+	if (sscanf(s, "%ux%u", &w, &h) != 2 || !w || !h)
+		return false;
+	*cx = w;
+	*cy = h;
+	return true;
+}
+
+static bool parse_source(const char *s, struct frame_source *src)
+{
+	if (strcmp(s, "testcard") == 0) {
+		src->testcard = true;
+		return true;
+	}
+	if (*s == '#')
+		s++;
+	unsigned int rgb;
+	if (strlen(s) != 6 || sscanf(s, "%6x", &rgb) != 1)
+		return false;
+	src->testcard = false;
+	src->color[0] = (uint8_t)(rgb >> 16);
+	src->color[1] = (uint8_t)(rgb >> 8);
+	src->color[2] = (uint8_t)rgb;
+	src->color[3] = 255;
+	return true;
+}
+
+static bool parse_layout(const char *s, enum layout *layout)
+{
+	static const char *names[] = {"horizontal", "vertical", "mask",
+				      "none"};
+	for (int i = 0; i < 4; i++) {
+		if (strcmp(s, names[i]) == 0) {
+			*layout = (enum layout)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	struct render_options opt = {
+		.cx = 1920,
+		.cy = 1080,
+		.fps_num = 60,
+		.fps_den = 1,
+		.duration_ms = 500.0,
+		.transition_point = 0.5,
+		.layout = LAYOUT_HORIZONTAL,
+		.png = true,
+		.last = UINT64_MAX,
+	};
+	struct frame_source a = {.color = {0, 0, 0, 255}};
+	struct frame_source b = {.testcard = true};
+	bool media_size = false;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		bool ok = true;
+
+		if (strcmp(arg, "--invert") == 0) {
+			opt.invert = true;
+			continue;
+		} else if (strcmp(arg, "--linear") == 0) {
+			opt.linear = true;
+			continue;
+		} else if (!value) {
+			ok = false;
+		} else if (strcmp(arg, "-o") == 0) {
+			opt.output = value;
+		} else if (strcmp(arg, "--size") == 0) {
+			ok = parse_size(value, &opt.cx, &opt.cy);
+		} else if (strcmp(arg, "--fps") == 0) {
+			unsigned int num, den = 1;
+			ok = sscanf(value, "%u/%u", &num, &den) >= 1 && num &&
+			     den;
+			opt.fps_num = num;
+			opt.fps_den = den;
+		} else if (strcmp(arg, "--duration") == 0) {
+			opt.duration_ms = atof(value);
+			ok = opt.duration_ms > 0.0;
+		} else if (strcmp(arg, "--point") == 0) {
+			opt.transition_point = atof(value) / 100.0;
+		} else if (strcmp(arg, "--a") == 0) {
+			ok = parse_source(value, &a);
+		} else if (strcmp(arg, "--b") == 0) {
+			ok = parse_source(value, &b);
+		} else if (strcmp(arg, "--frames") == 0) {
+			opt.frames_path = value;
+		} else if (strcmp(arg, "--media") == 0) {
+			ok = parse_size(value, &opt.media_cx, &opt.media_cy);
+			media_size = ok;
+		} else if (strcmp(arg, "--layout") == 0) {
+			ok = parse_layout(value, &opt.layout);
+		} else if (strcmp(arg, "--format") == 0) {
+			opt.png = strcmp(value, "png") == 0;
+			ok = opt.png || strcmp(value, "rgba") == 0;
+		} else if (strcmp(arg, "--range") == 0) {
+			unsigned long long first, last;
+			ok = sscanf(value, "%llu-%llu", &first, &last) == 2 &&
+			     first <= last;
+			opt.first = first;
+			opt.last = last + 1;
+		} else if (strcmp(arg, "--threads") == 0) {
+			opt.threads = atoi(value);
+			ok = opt.threads > 0 && opt.threads <= MAX_THREADS;
+		} else {
+			ok = false;
+		}
+
+		if (!ok) {
+			fprintf(stderr, "Invalid argument '%s'\n", arg);
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+	}
+
+	if (!opt.output ||
+	    (opt.frames_path &&
+	     (!media_size || opt.media_cx < 2 || opt.media_cy < 2))) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (opt.frames_path) {
+		FILE *file = fopen(opt.frames_path, "rb");
+		if (!file || fseek64(file, 0, SEEK_END) != 0) {
+			fprintf(stderr, "Could not open '%s': %s\n",
+				opt.frames_path, strerror(errno));
+			if (file)
+				fclose(file);
+			return 1;
+		}
+		const long long size = ftell64(file);
+		fclose(file);
+		opt.frame_count = (uint64_t)size /
+				  ((uint64_t)opt.media_cx * opt.media_cy * 4);
+		if (!opt.frame_count) {
+			fprintf(stderr, "'%s' holds no %ux%u frames\n",
+				opt.frames_path, opt.media_cx, opt.media_cy);
+			return 1;
+		}
+	}
+
+	/* 48 kHz only matters for the audio side of the schedule */
+	transition_schedule_init(&opt.schedule, opt.duration_ms,
+				 opt.transition_point, opt.fps_num,
+				 opt.fps_den, 48000);
+	const uint64_t total = opt.schedule.total_frames + 1;
+	if (opt.last > total)
+		opt.last = total;
+	if (opt.first >= opt.last) {
+		fprintf(stderr,
+			"Nothing to render, the transition has %llu frames\n",
+			(unsigned long long)total);
+		return 1;
+	}
+
+	const size_t pixels = (size_t)opt.cx * opt.cy;
+	opt.a = malloc(pixels * 4);
+	opt.b = malloc(pixels * 4);
+	if (!opt.a || !opt.b) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	fill_frame(opt.a, opt.cx, opt.cy, &a);
+	fill_frame(opt.b, opt.cx, opt.cy, &b);
+
+	for (size_t i = 0; i < 256; i++)
+		opt.to_linear[i] =
+			matte_srgb_nonlinear_to_linear((float)i / 255.0f);
+
+	const uint64_t frames = opt.last - opt.first;
+	if (!opt.threads)
+		opt.threads = cpu_count();
+	if ((uint64_t)opt.threads > frames)
+		opt.threads = (int)frames;
+
+	struct render_job jobs[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	bool started[MAX_THREADS];
+	for (int i = 0; i < opt.threads; i++) {
+		jobs[i] = (struct render_job){
+			.opt = &opt,
+			.first = opt.first + frames * i / opt.threads,
+			.last = opt.first + frames * (i + 1) / opt.threads,
+		};
+		started[i] = pthread_create(&threads[i], NULL, render_range,
+					    &jobs[i]) == 0;
+	}
+
+	bool failed = false;
+	for (int i = 0; i < opt.threads; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		failed = failed || !started[i] || jobs[i].failed;
+	}
+
+	free(opt.a);
+	free(opt.b);
+
+	if (failed) {
+		fprintf(stderr, "Rendering failed\n");
+		return 1;
+	}
+	printf("Rendered frames %llu-%llu of %llu\n",
+	       (unsigned long long)opt.first,
+	       (unsigned long long)opt.last - 1, (unsigned long long)total);
+	return 0;
+}
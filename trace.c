@@ -0,0 +1,313 @@
+#include "trace.h"
+#include "obs-module.h"
+#include <util/platform.h>
+#include <util/threading.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_BUFFER_EVENTS 4096
+#define TRACE_FLUSH_MS 100
+
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+struct trace_event {
+	const char *name;
+	const char *arg;
+	uint64_t ts;
+	uint64_t dur;
+	uint32_t pid;
+	char phase;
+};
+
+/* single producer (the owning thread), single consumer (the writer) */
+struct trace_buffer {
+	struct trace_event events[TRACE_BUFFER_EVENTS];
+	volatile long head;
+	volatile long tail;
+	long tid;
+	struct trace_buffer *next;
+};
+
+struct trace_process {
+	uint32_t pid;
+	char *name;
+	bool written;
+	struct trace_process *next;
+};
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_buffer *buffers = NULL;
+static struct trace_process *processes = NULL;
+static long trace_refs = 0;
+static long next_tid = 0;
+static FILE *trace_file = NULL;
+static char *trace_path = NULL;
+static bool first_event = true;
+static pthread_t writer_thread;
+static os_event_t *stop_event = NULL;
+
+static volatile bool active = false;
+static volatile long next_pid = 0;
+static volatile long dropped = 0;
+
+static TRACE_THREAD_LOCAL struct trace_buffer *thread_buffer = NULL;
+
+static void write_string(const char *str)
+{
+	for (; *str; str++) {
+		const unsigned char c = (unsigned char)*str;
+		if (c == '"' || c == '\\')
+			fprintf(trace_file, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(trace_file, "\\u%04x", c);
+		else
+			fputc(c, trace_file);
+	}
+}
+
+static void write_separator(void)
+{
+	fputs(first_event ? "\n" : ",\n", trace_file);
+	first_event = false;
+}
+
+static void write_event(const struct trace_event *event, long tid)
+{
+	write_separator();
+	fprintf(trace_file,
+		"{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%u,\"tid\":%ld",
+		event->name, event->phase, (double)event->ts / 1000.0,
+		event->pid, tid);
+	if (event->phase == 'X')
+		fprintf(trace_file, ",\"dur\":%.3f",
+			(double)event->dur / 1000.0);
+	else if (event->phase == 'i')
+		fputs(",\"s\":\"t\"", trace_file);
+	if (event->arg)
+		fprintf(trace_file, ",\"args\":{\"value\":\"%s\"}", event->arg);
+	fputc('}', trace_file);
+}
+
+/* called with trace_mutex held */
+static void drain(void)
+{
+	for (struct trace_process *p = processes; p; p = p->next) {
+		if (p->written)
+			continue;
+		write_separator();
+		fprintf(trace_file,
+			"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"",
+			p->pid);
+		write_string(p->name);
+		fputs("\"}}", trace_file);
+		p->written = true;
+	}
+
+	for (struct trace_buffer *b = buffers; b; b = b->next) {
+		long tail = os_atomic_load_long(&b->tail);
+		const long head = os_atomic_load_long(&b->head);
+		while (tail != head) {
+			write_event(&b->events[tail], b->tid);
+			tail = (tail + 1) % TRACE_BUFFER_EVENTS;
+		}
+		os_atomic_set_long(&b->tail, tail);
+	}
+	fflush(trace_file);
+}
+
+static void *trace_writer(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_set_thread_name("browser-transition: trace writer");
+
+	while (os_event_timedwait(stop_event, TRACE_FLUSH_MS) == ETIMEDOUT) {
+		pthread_mutex_lock(&trace_mutex);
+		drain();
+		pthread_mutex_unlock(&trace_mutex);
+	}
+	return NULL;
+}
+
+bool trace_start(const char *path)
+{
+	pthread_mutex_lock(&trace_mutex);
+	if (trace_refs) {
+		/* there is one writer, events of another file would end up in
+		 * the one already open */
+		const bool same = path && strcmp(path, trace_path) == 0;
+		if (same)
+			trace_refs++;
+		else
+			blog(LOG_WARNING,
+			     "[Browser Transition] Already tracing to '%s', "
+			     "not tracing to '%s'",
+			     trace_path, path ? path : "");
+		pthread_mutex_unlock(&trace_mutex);
+		return same;
+	}
+	trace_refs++;
+
+	trace_file = path && *path ? os_fopen(path, "w") : NULL;
+	if (!trace_file ||
+	    os_event_init(&stop_event, OS_EVENT_TYPE_MANUAL) != 0) {
+		blog(LOG_WARNING,
+		     "[Browser Transition] Could not start trace to '%s'",
+		     path ? path : "");
+		if (trace_file)
+			fclose(trace_file);
+		trace_file = NULL;
+		trace_refs--;
+		pthread_mutex_unlock(&trace_mutex);
+		return false;
+	}
+
+	trace_path = bstrdup(path);
+	fputc('[', trace_file);
+	first_event = true;
+	for (struct trace_process *p = processes; p; p = p->next)
+		p->written = false;
+	for (struct trace_buffer *b = buffers; b; b = b->next)
+		os_atomic_set_long(&b->tail, os_atomic_load_long(&b->head));
+	os_atomic_set_long(&dropped, 0);
+
+	pthread_create(&writer_thread, NULL, trace_writer, NULL);
+	os_atomic_set_bool(&active, true);
+	pthread_mutex_unlock(&trace_mutex);
+
+	blog(LOG_INFO, "[Browser Transition] Tracing to '%s'", path);
+	return true;
+}
+
+void trace_stop(void)
+{
+	pthread_mutex_lock(&trace_mutex);
+	if (!trace_refs || --trace_refs) {
+		pthread_mutex_unlock(&trace_mutex);
+		return;
+	}
+	os_atomic_set_bool(&active, false);
+	pthread_mutex_unlock(&trace_mutex);
+
+	os_event_signal(stop_event);
+	pthread_join(writer_thread, NULL);
+
+	pthread_mutex_lock(&trace_mutex);
+	drain();
+	fputs("\n]\n", trace_file);
+	fclose(trace_file);
+	trace_file = NULL;
+	bfree(trace_path);
+	trace_path = NULL;
+	os_event_destroy(stop_event);
+	stop_event = NULL;
+	pthread_mutex_unlock(&trace_mutex);
+
+	const long lost = os_atomic_load_long(&dropped);
+	if (lost)
+		blog(LOG_WARNING,
+		     "[Browser Transition] Trace stopped, %ld events dropped",
+		     lost);
+}
+
+void trace_free(void)
+{
+	pthread_mutex_lock(&trace_mutex);
+	while (buffers) {
+		struct trace_buffer *next = buffers->next;
+		bfree(buffers);
+		buffers = next;
+	}
+	while (processes) {
+		struct trace_process *next = processes->next;
+		bfree(processes->name);
+		bfree(processes);
+		processes = next;
+	}
+	thread_buffer = NULL;
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+bool trace_active(void)
+{
+	return os_atomic_load_bool(&active);
+}
+
+uint32_t trace_new_pid(void)
+{
+	return (uint32_t)os_atomic_inc_long(&next_pid);
+}
+
+void trace_set_process_name(uint32_t pid, const char *name)
+{
+	pthread_mutex_lock(&trace_mutex);
+	struct trace_process *p = processes;
+	while (p && p->pid != pid)
+		p = p->next;
+	if (!p) {
+		p = bzalloc(sizeof(struct trace_process));
+		p->pid = pid;
+		p->next = processes;
+		processes = p;
+	}
+	bfree(p->name);
+	p->name = bstrdup(name ? name : "");
+	p->written = false;
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+static void push_event(const struct trace_event *event)
+{
+	struct trace_buffer *b = thread_buffer;
+	if (!b) {
+		b = bzalloc(sizeof(struct trace_buffer));
+		pthread_mutex_lock(&trace_mutex);
+		b->tid = ++next_tid;
+		b->next = buffers;
+		buffers = b;
+		pthread_mutex_unlock(&trace_mutex);
+		thread_buffer = b;
+	}
+
+	const long head = os_atomic_load_long(&b->head);
+	const long next = (head + 1) % TRACE_BUFFER_EVENTS;
+	if (next == os_atomic_load_long(&b->tail)) {
+		os_atomic_inc_long(&dropped);
+		return;
+	}
+	b->events[head] = *event;
+	os_atomic_set_long(&b->head, next);
+}
+
+void trace_complete(uint32_t pid, const char *name, uint64_t begin_ns,
+		    uint64_t end_ns)
+{
+	if (!trace_active())
+		return;
+	struct trace_event event = {
+		.name = name,
+		.ts = begin_ns,
+		.dur = end_ns - begin_ns,
+		.pid = pid,
+		.phase = 'X',
+	};
+	push_event(&event);
+}
+
+void trace_instant(uint32_t pid, const char *name, const char *arg)
+{
+	if (!trace_active())
+		return;
+	struct trace_event event = {
+		.name = name,
+		.arg = arg,
+		.ts = os_gettime_ns(),
+		.pid = pid,
+		.phase = 'i',
+	};
+	push_event(&event);
+}
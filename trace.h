@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Opt-in Chrome/Perfetto trace export. Events are written to a lock-free
+ * buffer owned by the calling thread and a background thread writes them to
+ * the trace file, so recording an event never blocks.
+ *
+ * Event names and args must be string literals, they are not copied.
+ */
+
+/* reference counted per process, starting another path while a trace is
+ * running logs the conflict and fails */
+bool trace_start(const char *path);
+void trace_stop(void);
+void trace_free(void);
+
+bool trace_active(void);
+uint32_t trace_new_pid(void);
+void trace_set_process_name(uint32_t pid, const char *name);
+
+void trace_complete(uint32_t pid, const char *name, uint64_t begin_ns,
+		    uint64_t end_ns);
+void trace_instant(uint32_t pid, const char *name, const char *arg);
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Converts the transition point into a video frame index and an audio sample
+ * index that fall on the same frame boundary, so the video cut and the audio
+ * crossover always switch together.
+ */
+struct transition_schedule {
+	bool valid;
+	double frames_per_ms;
+	double samples_per_ms;
+	double duration_ms;
+	double delay_ms;
+	uint64_t total_frames;
+	uint64_t cut_frame;
+	uint64_t total_samples;
+	uint64_t cut_sample;
+};
+
+static inline void transition_schedule_init(struct transition_schedule *ts,
+					    double duration_ms,
+					    double transition_point,
+					    uint32_t fps_num, uint32_t fps_den,
+					    uint32_t sample_rate)
+{
+	ts->valid = fps_num && fps_den && sample_rate && duration_ms > 0.0;
+	if (!ts->valid)
+		return;
+
+	if (transition_point < 0.0)
+		transition_point = 0.0;
+	else if (transition_point > 1.0)
+		transition_point = 1.0;
+
+	ts->duration_ms = duration_ms;
+	ts->delay_ms = 0.0;
+	ts->frames_per_ms = (double)fps_num / ((double)fps_den * 1000.0);
+	ts->samples_per_ms = (double)sample_rate / 1000.0;
+	ts->total_frames = (uint64_t)(duration_ms * ts->frames_per_ms + 0.5);
+	ts->cut_frame = (uint64_t)(transition_point * duration_ms *
+					   ts->frames_per_ms +
+				   0.5);
+	if (ts->cut_frame > ts->total_frames)
+		ts->cut_frame = ts->total_frames;
+
+	ts->total_samples = (uint64_t)(duration_ms * ts->samples_per_ms + 0.5);
+	ts->cut_sample = (ts->cut_frame * fps_den * sample_rate +
+			  fps_num / 2) /
+			 fps_num;
+	if (ts->cut_sample > ts->total_samples)
+		ts->cut_sample = ts->total_samples;
+}
+
+/* the stinger is shown delay_ms late, the transition runs that much longer
+ * and its time is mapped back onto the stinger's own timeline */
+static inline void
+transition_schedule_set_delay(struct transition_schedule *ts, double delay_ms)
+{
+	ts->delay_ms = delay_ms > 0.0 ? delay_ms : 0.0;
+}
+
+static inline double
+transition_schedule_total_ms(const struct transition_schedule *ts)
+{
+	return ts->duration_ms + ts->delay_ms;
+}
+
+static inline double transition_schedule_ms(const struct transition_schedule *ts,
+					    float t)
+{
+	return (double)t * transition_schedule_total_ms(ts) - ts->delay_ms;
+}
+
+static inline uint64_t
+transition_schedule_frame(const struct transition_schedule *ts, float t)
+{
+	const double ms = transition_schedule_ms(ts, t);
+	if (ms <= 0.0)
+		return 0;
+	return (uint64_t)(ms * ts->frames_per_ms + 0.5);
+}
+
+static inline uint64_t
+transition_schedule_sample(const struct transition_schedule *ts, float t)
+{
+	const double ms = transition_schedule_ms(ts, t);
+	if (ms <= 0.0)
+		return 0;
+	return (uint64_t)(ms * ts->samples_per_ms + 0.5);
+}
+
+static inline double
+transition_schedule_cut_ms(const struct transition_schedule *ts)
+{
+	return (double)ts->cut_frame / ts->frames_per_ms;
+}
+
+static inline bool transition_schedule_use_a(const struct transition_schedule *ts,
+					     float t)
+{
+	return transition_schedule_frame(ts, t) < ts->cut_frame;
+}
+
+/* fade out to the cut sample, then fade in from it */
+static inline float
+transition_schedule_fade_a(const struct transition_schedule *ts, float t)
+{
+	const uint64_t sample = transition_schedule_sample(ts, t);
+	if (sample >= ts->cut_sample)
+		return 0.0f;
+	return 1.0f - (float)((double)sample / (double)ts->cut_sample);
+}
+
+static inline float
+transition_schedule_fade_b(const struct transition_schedule *ts, float t)
+{
+	const uint64_t sample = transition_schedule_sample(ts, t);
+	if (sample < ts->cut_sample)
+		return 0.0f;
+	if (sample >= ts->total_samples)
+		return 1.0f;
+	return (float)((double)(sample - ts->cut_sample) /
+		       (double)(ts->total_samples - ts->cut_sample));
+}